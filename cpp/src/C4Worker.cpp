@@ -26,6 +26,30 @@ constexpr int MAX_QUEUE_SIZE = 4;
 constexpr float DIRICHLET_EPSILON = 0.25f;
 constexpr float DIRICHLET_ALPHA = 0.5f;
 
+constexpr int NUM_SEARCH_THREADS = 1;  // Threads for tree-parallel search within each game.
+
+constexpr int NUM_PARALLEL_GAMES = 1;          // Games played concurrently, sharing one inference thread.
+constexpr int INFERENCE_BATCH_SIZE = 256;      // Batch size at which the inference thread evaluates immediately.
+constexpr int INFERENCE_MAX_WAIT_MICROS = 1000;  // Longest the inference thread waits for a batch to fill.
+
+constexpr SPRL::Transpositions TRANSPOSITIONS = SPRL::Transpositions::EVALUATIONS;  // Connect Four transposes constantly.
+constexpr int LOG2_EVAL_CACHE_SIZE = 16;  // Evaluations remembered across the games of an iteration.
+constexpr size_t MAX_TREE_NODES = 0;  // Connect Four trees stay small, so no node budget.
+constexpr bool PIPELINE_SEARCH = true;  // Select the next batch of leaves while the last is evaluated.
+
+constexpr int FAST_UCT_TRAVERSALS = 0;      // Traversals of cheap searches for playout cap randomization, zero for none.
+constexpr float FULL_SEARCH_PROB = 0.25f;  // Fraction of moves searched in full, if randomizing playout caps.
+constexpr int NUM_ROOT_TREES = 1;  // Independent trees searched per move and merged, one thread each, one for a single tree.
+
+constexpr bool TUNE_QUEUE_SIZE = true;  // Tune MAX_QUEUE_SIZE while searching, and log the result to pin it.
+constexpr int MAX_TUNED_QUEUE_SIZE = 32;  // Largest queue size the tuning may pick.
+constexpr float MAX_COLLISION_RATE = 0.1f;  // Largest fraction of colliding leaf selections per batch.
+
+constexpr bool USE_SOLVER = false;  // Prove positions from the terminals up, and play by the proofs.
+constexpr int GUMBEL_ACTIONS = 0;  // Actions sampled per move by Gumbel search, zero for PUCT with Dirichlet noise.
+constexpr bool SPECULATIVE_FILL = false;  // Top up short batches with likely leaves, cached for later traversals.
+constexpr int PRUNE_WIDTH = 0;  // Ignored: Connect Four nodes keep dense, unranked edges.
+
 
 int main(int argc, char *argv[]) {
     std::string runName = "c4_test";  // Change me too!
@@ -61,7 +85,12 @@ int main(int argc, char *argv[]) {
         NUM_ITERS,
         INIT_NUM_GAMES_PER_WORKER, INIT_UCT_TRAVERSALS, INIT_MAX_BATCH_SIZE, INIT_MAX_QUEUE_SIZE,
         NUM_GAMES_PER_WORKER, UCT_TRAVERSALS, MAX_BATCH_SIZE, MAX_QUEUE_SIZE,
-        DIRICHLET_EPSILON, DIRICHLET_ALPHA
+        DIRICHLET_EPSILON, DIRICHLET_ALPHA, NUM_SEARCH_THREADS,
+        NUM_PARALLEL_GAMES, INFERENCE_BATCH_SIZE, INFERENCE_MAX_WAIT_MICROS,
+        TRANSPOSITIONS, LOG2_EVAL_CACHE_SIZE, MAX_TREE_NODES, PIPELINE_SEARCH,
+        FAST_UCT_TRAVERSALS, FULL_SEARCH_PROB, NUM_ROOT_TREES,
+        TUNE_QUEUE_SIZE, MAX_TUNED_QUEUE_SIZE, MAX_COLLISION_RATE, USE_SOLVER, GUMBEL_ACTIONS,
+        SPECULATIVE_FILL, PRUNE_WIDTH
     );
 
     return 0;
@@ -37,9 +37,15 @@ constexpr int BOARD_SIZE = NUM_ROWS * NUM_COLS;
 constexpr int ACTION_SIZE = SPRL::OTH_ACTION_SIZE;
 constexpr int HISTORY_SIZE = SPRL::OTH_HISTORY_SIZE;
 
+// Traversals to search for while the human thinks, capped to bound the memory used.
+constexpr int PONDER_TRAVERSALS = 1 << 17;
+
+// Traversals to search the opening for, when there is no snapshot of it yet.
+constexpr int SNAPSHOT_TRAVERSALS = 1 << 18;
+
 int main(int argc, char* argv[]) {
-    if (argc != 6) {
-        std::cerr << "Usage: ./Challenge.exe <modelPath> <player> <numTraversals> <maxBatchSize> <maxQueueSize>" << std::endl;
+    if (argc < 6 || argc > 8) {
+        std::cerr << "Usage: ./Challenge.exe <modelPath> <player> <numTraversals> <maxBatchSize> <maxQueueSize> [secondsPerMove] [snapshotPath]" << std::endl;
         return 1;
     }
 
@@ -52,6 +58,12 @@ int main(int argc, char* argv[]) {
     int maxBatchSize = std::stoi(argv[4]);
     int maxQueueSize = std::stoi(argv[5]);
 
+    // With a time limit, the number of traversals is only a cap.
+    SPRL::TimeControl timeControl {};
+    if (argc >= 7) {
+        timeControl.m_moveSeconds = std::stof(argv[6]);
+    }
+
     SPRL::INetwork<State, ACTION_SIZE>* network;
 
     SPRL::OthelloHeuristic randomNetwork {};
@@ -72,17 +84,41 @@ int main(int argc, char* argv[]) {
         std::make_unique<ImplNode>(),
         0.25,
         0.1,
-        SPRL::InitQ::PARENT,
         &symmetrizer,
+        true,
+        false,
+        SPRL::Transpositions::NONE,
+        0,
         true
     };
 
+    // Warm start from a snapshot of the opening, searching and saving it the first time.
+    if (argc == 8) {
+        std::string snapshotPath = argv[7];
+
+        if (tree.loadSnapshot(snapshotPath)) {
+            std::cout << "Loaded opening snapshot..." << std::endl;
+        } else {
+            std::cout << "Searching opening for snapshot..." << std::endl;
+            tree.search(SNAPSHOT_TRAVERSALS, maxBatchSize, maxQueueSize, network);
+
+            if (!tree.saveSnapshot(snapshotPath)) {
+                std::cerr << "Could not save snapshot to " << snapshotPath << std::endl;
+            }
+        }
+    }
+
     SPRL::UCTNetworkAgent<ImplNode, State, ACTION_SIZE> networkAgent {
         network,
         &tree,
         numTraversals,
         maxBatchSize,
-        maxQueueSize
+        maxQueueSize,
+        1,
+        false,
+        false,
+        timeControl,
+        PONDER_TRAVERSALS
     };
 
     // SPRL::HumanAgent<ImplNode, State, ACTION_SIZE> humanAgent {};
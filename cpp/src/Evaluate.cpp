@@ -4,7 +4,7 @@
 #include <memory>
 
 #include "agents/HumanAgent.hpp"
-#include "agents/UCTNetworkAgent.hpp"
+#include "agents/RuntimeUCTNetworkAgent.hpp"
 
 #include "evaluate/play.hpp"
 
@@ -91,35 +91,25 @@ int main(int argc, char* argv[]) {
     auto pbar = tq::trange(numGames);
 
     for (int t : pbar) {
-        SPRL::UCTTree<ImplNode, State, ACTION_SIZE> tree0 {
-            std::make_unique<ImplNode>(),
-            0.25,
-            0.1,
+        SPRL::RuntimeUCTNetworkAgent<ImplNode, State, ACTION_SIZE> networkAgent0 {
             model0UseParentQ ? SPRL::InitQ::PARENT : SPRL::InitQ::ZERO,
-            model0UseSymmetrize ? &symmetrizer : nullptr,
-            true
-        };
-
-        SPRL::UCTTree<ImplNode, State, ACTION_SIZE> tree1 {
-            std::make_unique<ImplNode>(),
+            network0,
             0.25,
             0.1,
-            model1UseParentQ ? SPRL::InitQ::PARENT : SPRL::InitQ::ZERO,
-            model1UseSymmetrize ? &symmetrizer : nullptr,
-            true
-        };
-
-        SPRL::UCTNetworkAgent<ImplNode, State, ACTION_SIZE> networkAgent0 {
-            network0,
-            &tree0,
+            model0UseSymmetrize ? &symmetrizer : nullptr,
+            true,
             numTraversals,
             maxBatchSize,
             maxQueueSize
         };
 
-        SPRL::UCTNetworkAgent<ImplNode, State, ACTION_SIZE> networkAgent1 {
+        SPRL::RuntimeUCTNetworkAgent<ImplNode, State, ACTION_SIZE> networkAgent1 {
+            model1UseParentQ ? SPRL::InitQ::PARENT : SPRL::InitQ::ZERO,
             network1,
-            &tree1,
+            0.25,
+            0.1,
+            model1UseSymmetrize ? &symmetrizer : nullptr,
+            true,
             numTraversals,
             maxBatchSize,
             maxQueueSize
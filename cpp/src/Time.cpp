@@ -40,7 +40,6 @@ int main(int argc, char* argv[]) {
         std::make_unique<SPRL::ConnectFourNode>(),
         0.25f,
         0.3f,
-        SPRL::InitQ::PARENT,
         nullptr,
         false
     };
@@ -51,20 +50,11 @@ int main(int argc, char* argv[]) {
     while (!currentNode->isTerminal()) {
         t.reset();
 
-        int traversals = 0;
-        while (traversals < numTraversals) {
-            auto [leaves, trav] = tree.searchAndGetLeaves(maxBatchSize, maxQueueSize, &network);
+        tree.search(numTraversals, maxBatchSize, maxQueueSize, &network);
 
-            if (leaves.size() > 0) {
-                tree.evaluateAndBackpropLeaves(leaves, &network);
-            }
-
-            traversals += trav;
-        }
-
-        auto priors = tree.getDecisionNode()->getEdgeStatistics()->m_childPriors;
-        auto values = tree.getDecisionNode()->getEdgeStatistics()->m_totalValues;
-        auto visits = tree.getDecisionNode()->getEdgeStatistics()->m_numVisits;
+        auto priors = tree.getDecisionNode()->getEdgeStatistics().m_childPriors;
+        auto values = tree.getDecisionNode()->getEdgeStatistics().m_totalValues;
+        auto visits = tree.getDecisionNode()->getEdgeStatistics().m_numVisits;
 
         SPRL::ActionIdx action = std::distance(visits.begin(), std::max_element(visits.begin(), visits.end()));
 
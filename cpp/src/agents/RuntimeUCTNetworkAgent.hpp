@@ -0,0 +1,85 @@
+#ifndef SPRL_RUNTIME_UCT_NETWORK_AGENT_HPP
+#define SPRL_RUNTIME_UCT_NETWORK_AGENT_HPP
+
+#include "IAgent.hpp"
+#include "UCTNetworkAgent.hpp"
+
+#include "../networks/INetwork.hpp"
+#include "../symmetry/ISymmetrizer.hpp"
+#include "../uct/UCTTree.hpp"
+
+#include <memory>
+
+namespace SPRL {
+
+/**
+ * A `UCTNetworkAgent` whose method of initializing Q values is picked at runtime,
+ * e.g. from the command line of a tool comparing the methods, rather than compiled in.
+ *
+ * Owns a tree of its own, starting from a new `ImplNode`, and forwards every
+ * call to an agent instantiated for the chosen method.
+ *
+ * @tparam ImplNode The implementation of the game node, e.g. `GoNode`.
+ * @tparam State The state of the game, e.g. `GridState`.
+ * @tparam ACTION_SIZE The number of possible actions in the game.
+*/
+template <typename ImplNode, typename State, int ACTION_SIZE>
+class RuntimeUCTNetworkAgent : public IAgent<ImplNode, State, ACTION_SIZE> {
+public:
+    /**
+     * Constructs the tree and agent. See `UCTTree` and `UCTNetworkAgent` for the parameters.
+     *
+     * @param initQMethod The method for initializing Q values.
+    */
+    RuntimeUCTNetworkAgent(InitQ initQMethod, INetwork<State, ACTION_SIZE>* network,
+                           float dirEps, float dirAlpha, ISymmetrizer<State, ACTION_SIZE>* symmetrizer,
+                           bool addNoise, int numTraversals, int maxBatchSize, int maxQueueSize) {
+
+        switch (initQMethod) {
+        case InitQ::ZERO:
+            build<InitQ::ZERO>(network, dirEps, dirAlpha, symmetrizer, addNoise,
+                               numTraversals, maxBatchSize, maxQueueSize);
+            break;
+        case InitQ::PARENT:
+            build<InitQ::PARENT>(network, dirEps, dirAlpha, symmetrizer, addNoise,
+                                 numTraversals, maxBatchSize, maxQueueSize);
+            break;
+        case InitQ::DROP_PARENT:
+            build<InitQ::DROP_PARENT>(network, dirEps, dirAlpha, symmetrizer, addNoise,
+                                      numTraversals, maxBatchSize, maxQueueSize);
+            break;
+        }
+    }
+
+    ActionIdx act(const GameNode<ImplNode, State, ACTION_SIZE>* gameNode,
+                  bool verbose = false) const override {
+        return m_agent->act(gameNode, verbose);
+    }
+
+    void opponentAct(const ActionIdx action) const override {
+        m_agent->opponentAct(action);
+    }
+
+private:
+    template <InitQ INIT_Q>
+    void build(INetwork<State, ACTION_SIZE>* network,
+               float dirEps, float dirAlpha, ISymmetrizer<State, ACTION_SIZE>* symmetrizer,
+               bool addNoise, int numTraversals, int maxBatchSize, int maxQueueSize) {
+
+        auto tree = std::make_shared<UCTTree<ImplNode, State, ACTION_SIZE, INIT_Q>>(
+            std::make_unique<ImplNode>(), dirEps, dirAlpha, symmetrizer, addNoise);
+
+        m_agent = std::make_unique<UCTNetworkAgent<ImplNode, State, ACTION_SIZE, INIT_Q>>(
+            network, tree.get(), numTraversals, maxBatchSize, maxQueueSize);
+
+        m_tree = std::move(tree);
+    }
+
+    // Declared first, so that the tree outlives the agent searching it.
+    std::shared_ptr<void> m_tree;
+    std::unique_ptr<IAgent<ImplNode, State, ACTION_SIZE>> m_agent;
+};
+
+} // namespace SPRL
+
+#endif
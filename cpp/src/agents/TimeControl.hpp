@@ -0,0 +1,55 @@
+#ifndef SPRL_TIME_CONTROL_HPP
+#define SPRL_TIME_CONTROL_HPP
+
+#include <algorithm>
+
+namespace SPRL {
+
+/**
+ * How much wall-clock time an agent may spend thinking, either a fixed time
+ * per move, a clock for the whole game, or both, in which case the tighter wins.
+ * Non-positive times are unlimited.
+*/
+struct TimeControl {
+    float m_moveSeconds { 0.0f };       // Time for each move.
+    float m_gameSeconds { 0.0f };       // Time for the whole game.
+    float m_incrementSeconds { 0.0f };  // Time added to the game clock after each move.
+    int m_movesToGo { 20 };             // Moves to spread the game clock over.
+    float m_safetySeconds { 0.05f };    // Time kept back for overheads outside of search.
+
+    /**
+     * @returns Whether there is any limit on the time.
+    */
+    bool isLimited() const {
+        return m_moveSeconds > 0.0f || m_gameSeconds > 0.0f;
+    }
+
+    /**
+     * Budgets the next move. The game clock is spread evenly over the moves to go,
+     * plus the increment, but never so much that the clock would run out.
+     *
+     * @param remainingSeconds The time left on the game clock.
+     *
+     * @returns The time to spend on the next move, or zero if unlimited.
+    */
+    float allocate(float remainingSeconds) const {
+        float budget = 0.0f;
+
+        if (m_gameSeconds > 0.0f) {
+            budget = remainingSeconds / std::max(m_movesToGo, 1) + m_incrementSeconds;
+            budget = std::min(budget, remainingSeconds - m_safetySeconds);
+        }
+
+        if (m_moveSeconds > 0.0f) {
+            float moveBudget = m_moveSeconds - m_safetySeconds;
+            budget = (m_gameSeconds > 0.0f) ? std::min(budget, moveBudget) : moveBudget;
+        }
+
+        // Always leave some time to search, even when about to flag.
+        return isLimited() ? std::max(budget, 0.001f) : 0.0f;
+    }
+};
+
+} // namespace SPRL
+
+#endif
@@ -2,22 +2,32 @@
 #define SPRL_UCT_NETWORK_AGENT_HPP
 
 #include "IAgent.hpp"
+#include "TimeControl.hpp"
 
 #include "../networks/INetwork.hpp"
 #include "../uct/UCTTree.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 namespace SPRL {
 
 /**
  * Agent that uses the UCT algorithm with a neural network for action selection.
  * 
+ * If pondering, the agent keeps searching on a background thread after its own move,
+ * from the position the opponent is to move in, until the opponent moves. The subtree
+ * under the opponent's move is then kept along with its statistics, so the time the
+ * opponent took is not wasted.
+ * 
  * @tparam ImplNode The implementation of the game node, e.g. `GoNode`.
  * @tparam State The state of the game, e.g. `GridState`.
  * @tparam ACTION_SIZE The number of possible actions in the game.
+ * @tparam INIT_Q The method for initializing Q values of the tree, see `UCTNode`.
 */
-template <typename ImplNode, typename State, int ACTION_SIZE>
+template <typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q = InitQ::PARENT>
 class UCTNetworkAgent : public IAgent<ImplNode, State, ACTION_SIZE> {
 public:
     using ActionDist = GameActionDist<ACTION_SIZE>;
@@ -30,36 +40,58 @@ public:
      * @param numTraversals The number of UCT traversals to run per move.
      * @param maxBatchSize The maximum number of traversals per batch of search.
      * @param maxQueueSize The maximum number of states to evaluate per batch of search.
+     * @param numThreads The number of threads to run tree-parallel search with.
+     * @param pipelined Whether to overlap leaf selection with network evaluation.
+     * @param stopEarly Whether to stop searching once the most visited action is decided.
+     * @param timeControl The time the agent may think for. With a limit,
+     * `numTraversals` only caps the search, which otherwise stops on time.
+     * @param ponderTraversals The maximum number of traversals to run while the opponent
+     * thinks, or 0 to not ponder. The network must not be used elsewhere meanwhile,
+     * unless it is thread-safe.
     */
     UCTNetworkAgent(INetwork<State, ACTION_SIZE>* network,
-                    UCTTree<ImplNode, State, ACTION_SIZE>* tree,
-                    int numTraversals, int maxBatchSize, int maxQueueSize)
+                    UCTTree<ImplNode, State, ACTION_SIZE, INIT_Q>* tree,
+                    int numTraversals, int maxBatchSize, int maxQueueSize,
+                    int numThreads = 1, bool pipelined = false, bool stopEarly = false,
+                    TimeControl timeControl = {}, int ponderTraversals = 0)
         : m_network(network), m_tree(tree), m_numTraversals(numTraversals),
-          m_maxBatchSize(maxBatchSize), m_maxQueueSize(maxQueueSize) {
+          m_maxBatchSize(maxBatchSize), m_maxQueueSize(maxQueueSize),
+          m_numThreads(numThreads), m_pipelined(pipelined), m_stopEarly(stopEarly),
+          m_timeControl(timeControl), m_ponderTraversals(ponderTraversals),
+          m_remainingSeconds(timeControl.m_gameSeconds) {
     
     }
 
+    ~UCTNetworkAgent() {
+        stopPondering();
+    }
+
+    UCTNetworkAgent(const UCTNetworkAgent&) = delete;
+    UCTNetworkAgent& operator=(const UCTNetworkAgent&) = delete;
+
     ActionIdx act(const GameNode<ImplNode, State, ACTION_SIZE>* gameNode,
                   bool verbose = false) const override {
-        
-        int traversals = 0;
-        while (traversals < m_numTraversals) {
-            // Greedily search and collect leaves, expanding the tree iteratively.
-            auto [leaves, trav] = m_tree->searchAndGetLeaves(
-                m_maxBatchSize, m_maxQueueSize, m_network);
-
-            // If we have leaves, evaluate them using the NN and backpropagate.
-            if (leaves.size() > 0) {
-                m_tree->evaluateAndBackpropLeaves(leaves, m_network);
-            }
 
-            traversals += trav;
+        stopPondering();
+
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = std::chrono::steady_clock::time_point::max();
+
+        if (m_timeControl.isLimited()) {
+            float budget = m_timeControl.allocate(m_remainingSeconds);
+            deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(budget));
         }
 
+        // Greedily search and collect leaves, expanding the tree iteratively.
+        m_lastNumTraversals = m_tree->search(m_numTraversals, m_maxBatchSize, m_maxQueueSize,
+                                             m_network, 1.0f, m_numThreads, m_pipelined,
+                                             m_stopEarly, deadline);
+
         // Get the priors, values, and visits for the root node.
-        auto priors = m_tree->getDecisionNode()->getEdgeStatistics()->m_childPriors;
-        auto values = m_tree->getDecisionNode()->getEdgeStatistics()->m_totalValues;
-        auto visits = m_tree->getDecisionNode()->getEdgeStatistics()->m_numVisits;
+        auto priors = m_tree->getDecisionNode()->getEdgeStatistics().m_childPriors;
+        auto values = m_tree->getDecisionNode()->getEdgeStatistics().m_totalValues;
+        auto visits = m_tree->getDecisionNode()->getEdgeStatistics().m_numVisits;
 
         if (verbose) {
             std::cout << "Priors: ";
@@ -89,7 +121,17 @@ public:
         ActionIdx action = std::distance(visits.begin(),
             std::max_element(visits.begin(), visits.end()));
 
+        // Charge the game clock, including the time to pick the action.
+        float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        if (m_timeControl.m_gameSeconds > 0.0f) {
+            m_remainingSeconds += m_timeControl.m_incrementSeconds - elapsed;
+        }
+
         if (verbose) {
+            if (m_ponderTraversals > 0) {
+                std::cout << "Pondered traversals: " << m_lastNumPonderTraversals << '\n';
+            }
+            std::cout << "Traversals: " << m_lastNumTraversals << " in " << elapsed << "s\n";
             std::cout << "Action: " << action << '\n';
             std::cout << "Action prior: " << priors[action] << '\n';
             std::cout << "Action visits: " << visits[action] << '\n';
@@ -98,21 +140,86 @@ public:
         }
 
         // Advance the tree to the next decision node.
-        m_tree->advanceDecision(action);
+        m_tree->advanceDecision(action, m_ponderTraversals > 0);
+
+        startPondering();
 
         return action;
     }
 
     void opponentAct(const ActionIdx action) const override {
-        m_tree->advanceDecision(action);
+        stopPondering();
+
+        m_tree->advanceDecision(action, m_ponderTraversals > 0);
+    }
+
+    /**
+     * @returns The number of traversals performed for the last move.
+    */
+    int getLastNumTraversals() const {
+        return m_lastNumTraversals;
+    }
+
+    /**
+     * @returns The time left on the game clock, if there is one.
+    */
+    float getRemainingSeconds() const {
+        return m_remainingSeconds;
+    }
+
+    /**
+     * @returns The number of traversals run by the last pondering, once it has stopped.
+    */
+    int getLastNumPonderTraversals() const {
+        return m_lastNumPonderTraversals.load();
     }
 
 private:
+    /**
+     * Starts searching the current decision node in the background, if pondering.
+    */
+    void startPondering() const {
+        m_lastNumPonderTraversals = 0;
+
+        if (m_ponderTraversals <= 0 || m_tree->getDecisionNode()->isTerminal()) {
+            return;
+        }
+
+        m_stopPondering.store(false, std::memory_order_relaxed);
+        m_ponderThread = std::thread([this]() {
+            m_lastNumPonderTraversals = m_tree->search(
+                m_ponderTraversals, m_maxBatchSize, m_maxQueueSize, m_network, 1.0f, m_numThreads,
+                m_pipelined, false, std::chrono::steady_clock::time_point::max(), &m_stopPondering);
+        });
+    }
+
+    /**
+     * Stops the background search, if any, and waits for its current batch to finish.
+    */
+    void stopPondering() const {
+        if (m_ponderThread.joinable()) {
+            m_stopPondering.store(true, std::memory_order_relaxed);
+            m_ponderThread.join();
+        }
+    }
+
     INetwork<State, ACTION_SIZE>* m_network;
-    UCTTree<ImplNode, State, ACTION_SIZE>* m_tree;
+    UCTTree<ImplNode, State, ACTION_SIZE, INIT_Q>* m_tree;
     int m_numTraversals;
     int m_maxBatchSize;
     int m_maxQueueSize;
+    int m_numThreads;
+    bool m_pipelined;
+    bool m_stopEarly;
+    TimeControl m_timeControl;
+    int m_ponderTraversals;
+
+    // Acting is const, but the clock runs down and pondering goes on across moves.
+    mutable float m_remainingSeconds;
+    mutable int m_lastNumTraversals { 0 };
+    mutable std::atomic<int> m_lastNumPonderTraversals { 0 };
+    mutable std::atomic<bool> m_stopPondering { false };
+    mutable std::thread m_ponderThread;
 };
 
 } // namespace SPRL
@@ -9,4 +9,13 @@ constexpr int EARLY_GAME_CUTOFF = 15;
 constexpr float EARLY_GAME_EXP = 0.98f;
 constexpr float REST_GAME_EXP = 10.0f;
 
+// Scaling of the Q values added to the logits by Gumbel search, as in Gumbel MuZero.
+constexpr float GUMBEL_C_VISIT = 50.0f;
+constexpr float GUMBEL_C_SCALE = 1.0f;
+
+// Progressive unpruning: a node selects among one more move, by policy, once it has
+// UNPRUNE_VISITS visits, and again each time its visits grow by UNPRUNE_GROWTH, as in Crazy Stone.
+constexpr float UNPRUNE_VISITS = 40.0f;
+constexpr float UNPRUNE_GROWTH = 1.4f;
+
 #endif
@@ -18,9 +18,10 @@ void ConnectFourNode::setStartNodeImpl() {
     m_winner = Player::NONE;
     m_isTerminal = false;
     m_board.fill(Piece::NONE);
+    m_hash = 0;
 }
 
-std::unique_ptr<ConnectFourNode> ConnectFourNode::getNextNodeImpl(ActionIdx action) {
+ConnectFourNode::NodePtr ConnectFourNode::getNextNodeImpl(ActionIdx action) {
     assert(!m_isTerminal);
     assert(m_actionMask[action] > 0.0f);
 
@@ -46,6 +47,8 @@ std::unique_ptr<ConnectFourNode> ConnectFourNode::getNextNodeImpl(ActionIdx acti
     // Place the piece there
     newBoard[toIndex(row, col)] = piece;
 
+    ZobristHash newHash = m_hash ^ getPieceHash(toIndex(row, col), piece) ^ s_zobrist[PLAYER_ONE_ATOM];
+
     // Update the action mask if necessary
     if (row == 0) {
         newActionMask[col] = 0.0f;
@@ -71,10 +74,7 @@ std::unique_ptr<ConnectFourNode> ConnectFourNode::getNextNodeImpl(ActionIdx acti
         newActionMask.fill(0.0f);
     }
 
-    std::unique_ptr<ConnectFourNode> newNode = std::make_unique<ConnectFourNode>(
-        this, action, std::move(newActionMask), newPlayer, winner, terminal, std::move(newBoard));
-
-    return std::move(newNode);
+    return makeNode(this, action, std::move(newActionMask), newPlayer, winner, terminal, std::move(newBoard), newHash);
 }
 
 ConnectFourNode::State ConnectFourNode::getGameStateImpl() const {
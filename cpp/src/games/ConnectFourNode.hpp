@@ -40,18 +40,20 @@ public:
      * @param winner The new winner of the game, if any.
      * @param isTerminal Whether the game has ended.
      * @param board The new board state.
+     * @param hash The Zobrist hash of the new board state and player to move.
     */
     ConnectFourNode(ConnectFourNode* parent, ActionIdx action, ActionDist&& actionMask,
-                    Player player, Player winner, bool isTerminal, Board&& board)
+                    Player player, Player winner, bool isTerminal, Board&& board, ZobristHash hash)
         : GameNode<ConnectFourNode, State, C4_ACTION_SIZE> { parent, action, std::move(actionMask), player, winner, isTerminal },
-          m_board { std::move(board) } {
+          m_board { std::move(board) }, m_hash { hash } {
 
     }
 
 private:
     void setStartNodeImpl();
-    std::unique_ptr<ConnectFourNode> getNextNodeImpl(ActionIdx action);
+    NodePtr getNextNodeImpl(ActionIdx action);
     
+    ZobristHash getHashImpl() const { return m_hash; }
     State getGameStateImpl() const;
     std::array<Value, 2> getRewardsImpl() const;
 
@@ -61,7 +63,19 @@ private:
     static ActionIdx toIndex(int row, int col);
     static bool checkWin(const Board& board, const int row, const int col, const Piece piece);
 
+    /**
+     * @returns The Zobrist hash for a piece at a particular index.
+    */
+    static ZobristHash getPieceHash(int idx, Piece piece) {
+        return s_zobrist[idx + static_cast<int>(piece) * C4_BOARD_SIZE];
+    }
+
+    /// Static Zobrist hashes for (index, Piece) pairs, followed by one for player one to move.
+    static inline const Zobrist<C4_BOARD_SIZE * 2 + 1> s_zobrist {};
+    static constexpr int PLAYER_ONE_ATOM = C4_BOARD_SIZE * 2;
+
     Board m_board;
+    ZobristHash m_hash;  // The hash of the current board and player to move.
 
     friend class GameNode<ConnectFourNode, State, C4_ACTION_SIZE>;
     friend class ConnectFourNetwork;
@@ -26,9 +26,9 @@ public:
     }
 
     /**
-     * @returns The value at the given index.
+     * @returns A readonly reference to the value at the given index.
     */
-    float operator[](int idx) const {
+    const float& operator[](int idx) const {
         return m_data[idx];
     }
 
@@ -3,6 +3,9 @@
 
 #include "GameActionDist.hpp"
 
+#include "../utils/NodePool.hpp"
+#include "../utils/Zobrist.hpp"
+
 #include <cassert>
 #include <cstdint>
 #include <memory>
@@ -51,6 +54,7 @@ template <typename ImplNode, typename State, int ACTION_SIZE>
 class GameNode {
 public:
     using ActionDist = GameActionDist<ACTION_SIZE>;
+    using NodePtr = PoolPtr<ImplNode>;
 
     /**
      * Constructs a new game node.
@@ -86,6 +90,22 @@ public:
         return m_parent;
     }
 
+    /**
+     * @returns The pool that children of this node are allocated from,
+     * or `nullptr` if they are allocated on the heap.
+    */
+    NodePool<ImplNode>* getPool() const {
+        return m_pool;
+    }
+
+    /**
+     * Sets the pool that children of this node (and their descendants) are allocated from.
+     * Must be set before any children are created, and the pool must outlive them.
+    */
+    void setPool(NodePool<ImplNode>* pool) {
+        m_pool = pool;
+    }
+
     /**
      * @param action The action to take from the given state, must be legal.
      * 
@@ -98,7 +118,7 @@ public:
         assert(m_actionMask[action] > 0.0f);
 
         if (m_children[action] == nullptr) {
-            m_children[action] = std::move(getNextNode(action));
+            m_children[action] = getNextNode(action);
         }
 
         return m_children[action].get();
@@ -149,6 +169,14 @@ public:
         return m_actionMask;
     }
 
+    /**
+     * @returns A hash of the game state at this node, i.e. of everything
+     * the network sees, so that transposed positions hash the same.
+    */
+    ZobristHash getHash() const {
+        return static_cast<const ImplNode*>(this)->getHashImpl();
+    }
+
     /**
      * @returns The game state at this node, e.g. a short history of board states
      * that can be fed into the neural network.
@@ -171,7 +199,22 @@ public:
         return static_cast<const ImplNode*>(this)->toStringImpl();
     }
 
+    /**
+     * @returns The number of bytes the node holds on the heap, outside of itself and its
+     * children, e.g. the position history of Go. Must not change once the node is built.
+    */
+    size_t heapBytes() const {
+        return static_cast<const ImplNode*>(this)->heapBytesImpl();
+    }
+
 protected:
+    /**
+     * Default for games whose nodes hold nothing on the heap.
+    */
+    size_t heapBytesImpl() const {
+        return 0;
+    }
+
     /**
      * Mutates this node to the initial state of the game.
     */
@@ -184,12 +227,29 @@ protected:
      * 
      * @param action The action to take. Must be legal.
     */
-    std::unique_ptr<ImplNode> getNextNode(ActionIdx action) {
+    NodePtr getNextNode(ActionIdx action) {
         return static_cast<ImplNode*>(this)->getNextNodeImpl(action);
     }
 
+    /**
+     * Constructs a new node, in the same pool as this node if it has one.
+     * Implementations should create their children through this.
+     * 
+     * @param args The arguments forwarded to the constructor of `ImplNode`.
+    */
+    template <typename... Args>
+    NodePtr makeNode(Args&&... args) const {
+        ImplNode* node = (m_pool != nullptr) ? m_pool->create(std::forward<Args>(args)...)
+                                             : new ImplNode(std::forward<Args>(args)...);
+        node->m_pool = m_pool;
+
+        return NodePtr { node };
+    }
+
     ImplNode* m_parent;  // Raw pointer to the parent, nullptr if root.
-    std::array<std::unique_ptr<ImplNode>, ACTION_SIZE> m_children;  // Parent owns children.
+    std::array<NodePtr, ACTION_SIZE> m_children;  // Parent owns children.
+
+    NodePool<ImplNode>* m_pool { nullptr };  // Pool to allocate children from, if any.
 
     ActionIdx m_action;       // Action index taken into this node, 0 if root.
     ActionDist m_actionMask;  // Current action mask of legal moves.
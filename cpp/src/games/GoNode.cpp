@@ -1,6 +1,7 @@
 #include "GoNode.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
 #include <iostream>
 #include <queue>
@@ -316,7 +317,7 @@ void GoNode::setStartNodeImpl() {
     m_componentZobristValues.fill(0);
 }
 
-std::unique_ptr<GoNode> GoNode::getNextNodeImpl(ActionIdx actionIdx) {
+GoNode::NodePtr GoNode::getNextNodeImpl(ActionIdx actionIdx) {
 
     // Copy the state.
 
@@ -327,7 +328,7 @@ std::unique_ptr<GoNode> GoNode::getNextNodeImpl(ActionIdx actionIdx) {
     std::array<LibertyCount, GO_BOARD_SIZE> newLiberties = m_liberties;
     std::array<ZobristHash, GO_BOARD_SIZE> newComponentZobristValues = m_componentZobristValues;
 
-    auto copyNode = std::make_unique<GoNode>(
+    NodePtr copyNode = makeNode(
         m_parent,
         m_action,
         std::move(newActionMask),
@@ -382,6 +383,23 @@ std::unique_ptr<GoNode> GoNode::getNextNodeImpl(ActionIdx actionIdx) {
     return copyNode;
 }
 
+ZobristHash GoNode::getHashImpl() const {
+    ZobristHash hash = (m_player == Player::ONE) ? s_zobrist[PLAYER_ONE_ATOM] : 0;
+
+    // The network sees the last few boards, so they all go into the hash,
+    // rotated by their age so that the order matters.
+    const GoNode* current = this;
+
+    int t = 0;
+    while (t < GO_HISTORY_SIZE && current != nullptr) {
+        hash ^= std::rotl(current->m_hash, t);
+        current = current->m_parent;
+        ++t;
+    }
+
+    return hash;
+}
+
 GoNode::State GoNode::getGameStateImpl() const {
     std::array<Board, GO_HISTORY_SIZE> history;
 
@@ -405,6 +423,12 @@ std::array<Value, 2> GoNode::getRewardsImpl() const {
     }
 }
 
+size_t GoNode::heapBytesImpl() const {
+    // Buckets, plus one singly-linked list node per hash; leaves out the overhead of the allocator.
+    return m_zobristHistorySet.bucket_count() * sizeof(void*)
+        + m_zobristHistorySet.size() * (sizeof(void*) + sizeof(ZobristHash));
+}
+
 std::string GoNode::toStringImpl() const {
     std::string str = "";
 
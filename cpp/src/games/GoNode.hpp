@@ -5,7 +5,7 @@
 #include "GridState.hpp"
 
 #include "../utils/DSU.hpp"
-#include "../utils/zobrist.hpp"
+#include "../utils/Zobrist.hpp"
 
 #include <cassert>
 #include <unordered_set>
@@ -81,13 +81,16 @@ public:
 
 private:
     void setStartNodeImpl();
-    std::unique_ptr<GoNode> getNextNodeImpl(ActionIdx action);
+    NodePtr getNextNodeImpl(ActionIdx action);
     
+    ZobristHash getHashImpl() const;
     State getGameStateImpl() const;
     std::array<Value, 2> getRewardsImpl() const;
 
     std::string toStringImpl() const;
 
+    size_t heapBytesImpl() const;
+
 private:
     /**
      * @param row The row from the top, must be in the range `[0, GO_BOARD_WIDTH)`.
@@ -208,8 +211,9 @@ private:
     ActionDist computeActionMask() const;
 
 private:
-    /// Static Zobrist hashes for (Coord, Piece) pairs.
-    static inline const Zobrist<GO_BOARD_SIZE * 2> s_zobrist {};
+    /// Static Zobrist hashes for (Coord, Piece) pairs, followed by one for player one to move.
+    static inline const Zobrist<GO_BOARD_SIZE * 2 + 1> s_zobrist {};
+    static constexpr int PLAYER_ONE_ATOM = GO_BOARD_SIZE * 2;
 
     int m_depth;  // The depth of the node in the tree, starting at 0.
     
@@ -28,10 +28,17 @@ void OthelloNode::setStartNodeImpl() {
     m_board[toIndex(4, 3)] = Piece::ZERO;
     m_board[toIndex(4, 4)] = Piece::ONE;
 
+    m_hash = 0;
+    for (int i = 0; i < OTH_BOARD_SIZE; ++i) {
+        if (m_board[i] != Piece::NONE) {
+            m_hash ^= getPieceHash(i, m_board[i]);
+        }
+    }
+
     m_actionMask = actionMask(m_board, m_player);
 }
 
-std::unique_ptr<OthelloNode> OthelloNode::getNextNodeImpl(ActionIdx action) {
+OthelloNode::NodePtr OthelloNode::getNextNodeImpl(ActionIdx action) {
     assert(!m_isTerminal);
     assert(m_actionMask[action] > 0.0f);
 
@@ -46,17 +53,25 @@ std::unique_ptr<OthelloNode> OthelloNode::getNextNodeImpl(ActionIdx action) {
 
     const Piece piece = pieceFromPlayer(player);
 
+    ZobristHash newHash = m_hash ^ s_zobrist[PLAYER_ONE_ATOM];
+
     // Action index 64 is a pass.
     if (action != OTH_BOARD_SIZE) {
         // Place the piece there
         newBoard[action] = piece;
+        newHash ^= getPieceHash(action, piece);
 
         int row = action / OTH_BOARD_WIDTH;
         int col = action % OTH_BOARD_WIDTH;
 
         // Perform all the captures
-        for (const int idx : captures(newBoard, row, col, piece)) {
+        std::array<ActionIdx, OTH_BOARD_SIZE> captured;
+        const int numCaptured = captures(newBoard, row, col, piece, captured);
+
+        for (int i = 0; i < numCaptured; ++i) {
+            const int idx = captured[i];
             newBoard[idx] = piece;
+            newHash ^= getPieceHash(idx, otherPiece(piece)) ^ getPieceHash(idx, piece);
         }
     }
 
@@ -80,10 +95,7 @@ std::unique_ptr<OthelloNode> OthelloNode::getNextNodeImpl(ActionIdx action) {
         if (count1 > count0) winner = Player::ONE;
     }
 
-    std::unique_ptr<OthelloNode> newNode = std::make_unique<OthelloNode>(
-        this, action, actionMask(newBoard, newPlayer), newPlayer, winner, terminal, std::move(newBoard));
-
-    return std::move(newNode);
+    return makeNode(this, action, actionMask(newBoard, newPlayer), newPlayer, winner, terminal, std::move(newBoard), newHash);
 }
 
 OthelloNode::State OthelloNode::getGameStateImpl() const {
@@ -190,10 +202,11 @@ bool OthelloNode::isTerminal(const Board& board) {
     return mask1[OTH_BOARD_SIZE] > 0.0f;
 }
 
-const std::vector<ActionIdx> OthelloNode::captures(
-    const Board& board, const int row, const int col, const Piece piece) {
+int OthelloNode::captures(
+    const Board& board, const int row, const int col, const Piece piece,
+    std::array<ActionIdx, OTH_BOARD_SIZE>& output) {
 
-    std::vector<ActionIdx> output {};
+    int numCaptured = 0;
 
     constexpr int NUM_DIRS = 8;
     constexpr std::array<int, NUM_DIRS> r_delta { 1, 1, 0, -1, -1, -1, 0, 1 };
@@ -215,12 +228,12 @@ const std::vector<ActionIdx> OthelloNode::captures(
                  r != nextRow || c != nextCol;
                  r += r_delta[i], c += c_delta[i]) {
 
-                output.push_back(toIndex(r, c));
+                output[numCaptured++] = toIndex(r, c);
             }
         }
     }
 
-    return output;
+    return numCaptured;
 }
 
 bool OthelloNode::canCapture(const Board& board, int row, int col, const Piece piece) {
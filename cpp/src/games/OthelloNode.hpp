@@ -38,18 +38,20 @@ public:
      * @param winner The new winner of the game, if any.
      * @param isTerminal Whether the game has ended.
      * @param board The new board state.
+     * @param hash The Zobrist hash of the new board state and player to move.
     */
     OthelloNode(OthelloNode* parent, ActionIdx action, ActionDist&& actionMask,
-                Player player, Player winner, bool isTerminal, Board&& board)
+                Player player, Player winner, bool isTerminal, Board&& board, ZobristHash hash)
         : GameNode<OthelloNode, State, OTH_ACTION_SIZE> { parent, action, std::move(actionMask), player, winner, isTerminal },
-          m_board { std::move(board) } {
+          m_board { std::move(board) }, m_hash { hash } {
 
     }
 
 private:
     void setStartNodeImpl();
-    std::unique_ptr<OthelloNode> getNextNodeImpl(ActionIdx action);
+    NodePtr getNextNodeImpl(ActionIdx action);
     
+    ZobristHash getHashImpl() const { return m_hash; }
     State getGameStateImpl() const;
     std::array<Value, 2> getRewardsImpl() const;
 
@@ -70,16 +72,34 @@ private:
     static bool isTerminal(const Board& board);
 
     /**
-     * @returns The indices of the pieces that would be captured by placing a piece at the given position.
+     * Finds the pieces that would be captured by placing a piece at the given position,
+     * into a buffer rather than a vector, so that expanding the tree does not allocate.
+     *
+     * @param output Filled with the indices of the captured pieces.
+     *
+     * @returns The number of captured pieces.
      */
-    static const std::vector<ActionIdx> captures(const Board& board, const int row, const int col, const Piece piece);
+    static int captures(const Board& board, const int row, const int col, const Piece piece,
+                        std::array<ActionIdx, OTH_BOARD_SIZE>& output);
 
     /**
      * @returns Whether the given piece can capture any pieces by placing it at the given position.
      */
     static bool canCapture(const Board& board, int row, int col, const Piece piece);
 
+    /**
+     * @returns The Zobrist hash for a piece at a particular index.
+    */
+    static ZobristHash getPieceHash(int idx, Piece piece) {
+        return s_zobrist[idx + static_cast<int>(piece) * OTH_BOARD_SIZE];
+    }
+
+    /// Static Zobrist hashes for (index, Piece) pairs, followed by one for player one to move.
+    static inline const Zobrist<OTH_BOARD_SIZE * 2 + 1> s_zobrist {};
+    static constexpr int PLAYER_ONE_ATOM = OTH_BOARD_SIZE * 2;
+
     Board m_board;
+    ZobristHash m_hash;  // The hash of the current board and player to move.
 
     friend class GameNode<OthelloNode, State, OTH_ACTION_SIZE>;
     friend class OthelloHeuristic;
@@ -0,0 +1,313 @@
+#ifndef SPRL_CACHED_NETWORK_HPP
+#define SPRL_CACHED_NETWORK_HPP
+
+#include "../games/GridState.hpp"
+
+#include "../symmetry/ISymmetrizer.hpp"
+
+#include "../utils/AtomicFloat.hpp"
+#include "../utils/Zobrist.hpp"
+
+#include "INetwork.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+namespace SPRL {
+
+/**
+ * A network that remembers the outputs of the network it wraps, so that
+ * positions revisited within a game, after the tree is cleared, or in
+ * other games of the same iteration are only evaluated once.
+ *
+ * Entries are keyed by a Zobrist hash of the whole network input, i.e. the
+ * board history and the player to move. If given a symmetrizer, each state is
+ * first mapped to a canonical symmetry (the one with the smallest hash), so that
+ * symmetric positions share an entry.
+ *
+ * The cache is a fixed-size, direct-mapped table, with a newer entry always
+ * replacing an older one in its slot. Reads take no locks: each slot carries a
+ * sequence number that is odd while it is being written, and a reader that
+ * sees it change under them counts the lookup as a miss.
+ *
+ * The outputs are only valid for the wrapped network, so a cache should be
+ * constructed alongside each loaded model and never outlive it.
+ *
+ * @tparam BOARD_SIZE The size of the board.
+ * @tparam HISTORY_SIZE The maximum size of the history.
+ * @tparam ACTION_SIZE The size of the action space.
+*/
+template <int BOARD_SIZE, int HISTORY_SIZE, int ACTION_SIZE>
+class CachedNetwork : public INetwork<GridState<BOARD_SIZE, HISTORY_SIZE>, ACTION_SIZE> {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+    using State = GridState<BOARD_SIZE, HISTORY_SIZE>;
+
+    /**
+     * Constructs an empty cache in front of a network.
+     *
+     * @param network The network to evaluate cache misses with.
+     * @param log2NumSlots The base-2 logarithm of the number of entries.
+     * @param symmetrizer The symmetrizer to canonicalize states with, or nullptr.
+    */
+    CachedNetwork(INetwork<State, ACTION_SIZE>* network, int log2NumSlots,
+                  ISymmetrizer<State, ACTION_SIZE>* symmetrizer = nullptr)
+        : m_network { network }, m_symmetrizer { symmetrizer },
+          m_mask { (ZobristHash { 1 } << log2NumSlots) - 1 },
+          m_slots { std::make_unique<Slot[]>(m_mask + 1) } {
+
+        if (m_symmetrizer != nullptr) {
+            for (int i = 0; i < m_symmetrizer->numSymmetries(); ++i) {
+                m_allSymmetries.push_back(static_cast<SymmetryIdx>(i));
+            }
+        }
+    }
+
+    CachedNetwork(const CachedNetwork&) = delete;
+    CachedNetwork& operator=(const CachedNetwork&) = delete;
+
+    /**
+     * Answers the states found in the cache directly, and evaluates
+     * the rest in one batch with the wrapped network.
+     *
+     * @param states The states to evaluate.
+     * @param masks The action masks for the states.
+     *
+     * @return A vector of (policy, value) pairs for each state.
+    */
+    std::vector<std::pair<ActionDist, Value>> evaluate(
+        const std::vector<State>& states,
+        const std::vector<ActionDist>& masks) override {
+
+        assert(states.size() == masks.size());
+
+        int numStates = states.size();
+
+        std::vector<std::pair<ActionDist, Value>> results(numStates);
+        std::vector<SymmetryIdx> symmetries(numStates, 0);
+        std::vector<ZobristHash> hashes(numStates);
+
+        // Canonical states and masks of the misses, and where they go in the results.
+        std::vector<State> missStates;
+        std::vector<ActionDist> missMasks;
+        std::vector<int> missIndices;
+
+        for (int i = 0; i < numStates; ++i) {
+            State canonicalState = canonicalize(states[i], symmetries[i], hashes[i]);
+
+            if (lookup(hashes[i], results[i].first, results[i].second)) {
+                results[i].first = maskPolicy(uncanonicalize(results[i].first, symmetries[i]), masks[i]);
+                continue;
+            }
+
+            missStates.push_back(std::move(canonicalState));
+            missMasks.push_back((m_symmetrizer == nullptr)
+                ? masks[i]
+                : m_symmetrizer->symmetrizeSingleActionDist(masks[i], symmetries[i]));
+            missIndices.push_back(i);
+        }
+
+        m_numLookups += numStates;
+        m_numHits += numStates - static_cast<int>(missIndices.size());
+
+        if (!missIndices.empty()) {
+            std::vector<std::pair<ActionDist, Value>> outputs = m_network->evaluate(missStates, missMasks);
+
+            for (int j = 0; j < static_cast<int>(missIndices.size()); ++j) {
+                int i = missIndices[j];
+
+                store(hashes[i], outputs[j].first, outputs[j].second);
+                results[i] = { uncanonicalize(outputs[j].first, symmetries[i]), outputs[j].second };
+            }
+        }
+
+        return results;
+    }
+
+    /**
+     * @returns The number of evaluations made by the wrapped network, i.e. the cache misses.
+    */
+    int getNumEvals() override {
+        return m_network->getNumEvals();
+    }
+
+    bool isThreadSafe() const override {
+        return m_network->isThreadSafe();
+    }
+
+    /**
+     * @returns The number of states looked up in the cache so far.
+    */
+    int getNumLookups() const {
+        return m_numLookups.load();
+    }
+
+    /**
+     * @returns The number of states answered from the cache so far.
+    */
+    int getNumHits() const {
+        return m_numHits.load();
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> m_sequence { 0 };  // Odd while being written, zero while empty.
+        ZobristHash m_key { 0 };
+
+        float m_policy[ACTION_SIZE] {};  // Network policy output, for the canonical state.
+        float m_value { 0.0f };          // Network value output.
+    };
+
+    /**
+     * @returns The hash of the network input, i.e. the valid history and the player to move.
+     * History beyond the size is left out, as it is embedded as empty boards anyway.
+    */
+    static ZobristHash hashState(const State& state) {
+        ZobristHash hash = (state.getPlayer() == Player::ONE) ? s_zobrist[PLAYER_ONE_ATOM] : 0;
+
+        for (int t = 0; t < state.size(); ++t) {
+            for (int i = 0; i < BOARD_SIZE; ++i) {
+                Piece piece = state.getHistory()[t][i];
+                if (piece != Piece::NONE) {
+                    hash ^= s_zobrist[2 * (t * BOARD_SIZE + i) + static_cast<int>(piece)];
+                }
+            }
+        }
+
+        return hash;
+    }
+
+    /**
+     * @param state The state to canonicalize.
+     * @param symmetry Set to the symmetry taking the state to its canonical form.
+     * @param hash Set to the hash of the canonical form.
+     *
+     * @returns The canonical form of the state.
+    */
+    State canonicalize(const State& state, SymmetryIdx& symmetry, ZobristHash& hash) const {
+        if (m_symmetrizer == nullptr) {
+            symmetry = 0;
+            hash = hashState(state);
+            return state;
+        }
+
+        std::vector<State> symmetrized = m_symmetrizer->symmetrizeState(state, m_allSymmetries);
+
+        int best = 0;
+        for (int s = 0; s < static_cast<int>(symmetrized.size()); ++s) {
+            ZobristHash symmetrizedHash = hashState(symmetrized[s]);
+            if (s == 0 || symmetrizedHash < hash) {
+                best = s;
+                hash = symmetrizedHash;
+            }
+        }
+
+        symmetry = m_allSymmetries[best];
+        return symmetrized[best];
+    }
+
+    /**
+     * @returns The policy of a canonical state, mapped back onto the original state.
+    */
+    ActionDist uncanonicalize(const ActionDist& policy, SymmetryIdx symmetry) const {
+        if (m_symmetrizer == nullptr) {
+            return policy;
+        }
+
+        return m_symmetrizer->symmetrizeSingleActionDist(policy, m_symmetrizer->inverseSymmetry(symmetry));
+    }
+
+    /**
+     * Restricts a cached policy to the legal actions. In Go, legality also
+     * depends on positions older than the history, so may differ between hits.
+    */
+    static ActionDist maskPolicy(ActionDist policy, const ActionDist& mask) {
+        float sum = 0.0f;
+        int numLegal = 0;
+        for (int i = 0; i < ACTION_SIZE; ++i) {
+            if (mask[i] == 0.0f) {
+                policy[i] = 0.0f;
+            } else {
+                sum += policy[i];
+                ++numLegal;
+            }
+        }
+
+        for (int i = 0; i < ACTION_SIZE; ++i) {
+            if (mask[i] != 0.0f) {
+                policy[i] = (sum == 0.0f) ? 1.0f / numLegal : policy[i] / sum;
+            }
+        }
+
+        return policy;
+    }
+
+    /**
+     * Reads the entry for a hash without locking.
+     *
+     * @returns Whether the entry was found and read consistently.
+    */
+    bool lookup(ZobristHash hash, ActionDist& policy, Value& value) const {
+        const Slot& slot = m_slots[hash & m_mask];
+
+        uint32_t before = slot.m_sequence.load(std::memory_order_acquire);
+        if (before == 0 || (before & 1) != 0) {
+            return false;  // Empty, or being written.
+        }
+
+        if (std::atomic_ref<ZobristHash>(const_cast<ZobristHash&>(slot.m_key)).load(std::memory_order_relaxed) != hash) {
+            return false;
+        }
+
+        for (int i = 0; i < ACTION_SIZE; ++i) {
+            policy[i] = atomicLoad(slot.m_policy[i]);
+        }
+        value = atomicLoad(slot.m_value);
+
+        // Only trust the copy if no writer got in the way.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.m_sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    /**
+     * Writes the entry for a hash, evicting whatever was in its slot.
+     * Gives up if another thread is writing the same slot.
+    */
+    void store(ZobristHash hash, const ActionDist& policy, Value value) {
+        Slot& slot = m_slots[hash & m_mask];
+
+        uint32_t sequence = slot.m_sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) != 0
+            || !slot.m_sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+            return;
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::atomic_ref<ZobristHash>(slot.m_key).store(hash, std::memory_order_relaxed);
+        for (int i = 0; i < ACTION_SIZE; ++i) {
+            atomicStore(slot.m_policy[i], policy[i]);
+        }
+        atomicStore(slot.m_value, value);
+
+        slot.m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    static constexpr int PLAYER_ONE_ATOM = 2 * HISTORY_SIZE * BOARD_SIZE;
+    static inline const Zobrist<PLAYER_ONE_ATOM + 1> s_zobrist {};
+
+    INetwork<State, ACTION_SIZE>* m_network;
+    ISymmetrizer<State, ACTION_SIZE>* m_symmetrizer;
+    std::vector<SymmetryIdx> m_allSymmetries;  // Every symmetry, if there is a symmetrizer.
+
+    ZobristHash m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+
+    std::atomic<int> m_numLookups { 0 };
+    std::atomic<int> m_numHits { 0 };
+};
+
+} // namespace SPRL
+
+#endif
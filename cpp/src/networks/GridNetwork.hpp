@@ -98,33 +98,35 @@ public:
 
         auto output = m_model->forward({ input }).toTuple();
 
-        auto policyOutput = output->elements()[0].toTensor();
-        auto valueOutput = output->elements()[1].toTensor();
+        // Copy the outputs off the device once, rather than indexing the tensors element by element.
+        auto policyOutput = output->elements()[0].toTensor().to(torch::kCPU, torch::kFloat32).contiguous();
+        auto valueOutput = output->elements()[1].toTensor().to(torch::kCPU, torch::kFloat32).contiguous();
+
+        const float* logits = policyOutput.data_ptr<float>();
+        const float* values = valueOutput.data_ptr<float>();
 
         std::vector<std::pair<ActionDist, Value>> results;
         results.reserve(numStates);
 
         for (int b = 0; b < numStates; ++b) {
-            ActionDist policy;
-            for (int i = 0; i < ACTION_SIZE; ++i) {
-                policy[i] = policyOutput[b][i].item<float>();
-            }
+            const float* stateLogits = logits + b * ACTION_SIZE;
 
-            // Policy is returned as logits, so exponentiate.
-            policy = policy.exp();
-
-            // Mask out illegal actions
+            // Policy is returned as logits, so exponentiate, masking out illegal actions in the same pass.
+            ActionDist policy;
+            float sum = 0.0f;
             int numLegal = 0;
+
             for (int i = 0; i < ACTION_SIZE; ++i) {
                 if (masks[b][i] == 0.0f) {
                     policy[i] = 0.0f;
 
                 } else {
+                    policy[i] = std::exp(stateLogits[i]);
+                    sum += policy[i];
                     ++numLegal;
                 }
             }
 
-            float sum = policy.sum();
             if (sum == 0.0f) {
                 // If sum is zero, uniform over legal actions.
                 float uniform = 1.0f / numLegal;
@@ -138,7 +140,7 @@ public:
             }
 
             // Append the policy and value to the results.
-            results.emplace_back(policy, valueOutput[b].item<float>());
+            results.emplace_back(policy, values[b]);
         }
 
         return results;
@@ -30,6 +30,14 @@ public:
      * @returns The number of evaluations made by the network, summed over batches.
     */
     virtual int getNumEvals() = 0;
+
+    /**
+     * @returns Whether `evaluate` may be called concurrently from multiple threads.
+     * If not, callers such as tree-parallel search serialize their calls.
+    */
+    virtual bool isThreadSafe() const {
+        return false;
+    }
 };
 
 } // namespace SPRL
@@ -0,0 +1,213 @@
+#ifndef SPRL_INFERENCE_SERVICE_HPP
+#define SPRL_INFERENCE_SERVICE_HPP
+
+#include "INetwork.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace SPRL {
+
+/**
+ * A network that funnels evaluation requests from many threads into a
+ * single inference thread, which coalesces them into large batches
+ * for the wrapped network.
+ *
+ * Lets many self-play games run concurrently in one process while the
+ * underlying network (e.g. `GridNetwork`) sees batches many times larger
+ * than a single search would produce, amortizing its per-call overhead.
+ *
+ * @tparam State The state of the game, e.g. `GridState`.
+ * @tparam ACTION_SIZE The size of the action space.
+*/
+template <typename State, int ACTION_SIZE>
+class InferenceService : public INetwork<State, ACTION_SIZE> {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+    using Output = std::vector<std::pair<ActionDist, Value>>;
+
+    /**
+     * Constructs the service and starts its inference thread.
+     *
+     * @param network The network to evaluate batches with. Only ever
+     *                called from the inference thread, so need not be thread-safe.
+     * @param maxBatchSize The number of states at which a batch is sent off immediately.
+     * @param maxWait The longest time the oldest pending request waits for
+     *                the batch to fill up before it is sent off anyway.
+    */
+    InferenceService(INetwork<State, ACTION_SIZE>* network, int maxBatchSize,
+                     std::chrono::microseconds maxWait)
+        : m_network { network }, m_maxBatchSize { maxBatchSize }, m_maxWait { maxWait },
+          m_thread { &InferenceService::serve, this } {
+    }
+
+    ~InferenceService() override {
+        {
+            std::lock_guard<std::mutex> guard { m_mutex };
+            m_stopping = true;
+        }
+
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    InferenceService(const InferenceService&) = delete;
+    InferenceService& operator=(const InferenceService&) = delete;
+
+    /**
+     * Queues the states for evaluation in the next batch.
+     *
+     * @param states The states to evaluate.
+     * @param masks The action masks for the states.
+     *
+     * @returns A future holding the (policy, value) pairs for each state, in order.
+    */
+    std::future<Output> evaluateAsync(std::vector<State> states, std::vector<ActionDist> masks) {
+        assert(states.size() == masks.size());
+
+        Request request { std::move(states), std::move(masks), {}, std::chrono::steady_clock::now() };
+        std::future<Output> result = request.m_promise.get_future();
+
+        {
+            std::lock_guard<std::mutex> guard { m_mutex };
+            m_numQueuedStates += request.m_states.size();
+            m_queue.push_back(std::move(request));
+        }
+
+        m_cv.notify_all();
+        return result;
+    }
+
+    /**
+     * Blocks until the states have been evaluated as part of a batch.
+    */
+    Output evaluate(const std::vector<State>& states,
+                    const std::vector<ActionDist>& masks) override {
+
+        return evaluateAsync(states, masks).get();
+    }
+
+    int getNumEvals() override {
+        return m_numEvals.load();
+    }
+
+    bool isThreadSafe() const override {
+        return true;
+    }
+
+    /**
+     * @returns The number of batches sent to the wrapped network.
+    */
+    int getNumBatches() const {
+        return m_numBatches.load();
+    }
+
+private:
+    struct Request {
+        std::vector<State> m_states;
+        std::vector<ActionDist> m_masks;
+        std::promise<Output> m_promise;
+        std::chrono::steady_clock::time_point m_enqueued;  // When the request was queued.
+    };
+
+    /**
+     * Body of the inference thread: repeatedly waits for a batch
+     * to fill up (or for the oldest request to time out) and evaluates it.
+    */
+    void serve() {
+        while (true) {
+            std::vector<Request> batch;
+
+            {
+                std::unique_lock<std::mutex> lock { m_mutex };
+
+                m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+
+                if (m_queue.empty()) {
+                    return;  // Stopping, and nothing left to serve.
+                }
+
+                // Give other threads a chance to top up the batch, counting from when the oldest request
+                // was queued rather than from now, so that no request waits longer than `m_maxWait`.
+                auto deadline = m_queue.front().m_enqueued + m_maxWait;
+                m_cv.wait_until(lock, deadline, [this] {
+                    return m_stopping || m_numQueuedStates >= m_maxBatchSize;
+                });
+
+                // Always take at least one request, then as many as fit.
+                int numStates = 0;
+                do {
+                    numStates += static_cast<int>(m_queue.front().m_states.size());
+                    batch.push_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+
+                } while (!m_queue.empty()
+                         && numStates + static_cast<int>(m_queue.front().m_states.size()) <= m_maxBatchSize);
+
+                m_numQueuedStates -= numStates;
+            }
+
+            evaluateBatch(batch);
+        }
+    }
+
+    /**
+     * Evaluates the concatenation of all the requests in one network call,
+     * then hands each request its slice of the outputs.
+    */
+    void evaluateBatch(std::vector<Request>& batch) {
+        std::vector<State> states;
+        std::vector<ActionDist> masks;
+
+        for (Request& request : batch) {
+            states.insert(states.end(), request.m_states.begin(), request.m_states.end());
+            masks.insert(masks.end(), request.m_masks.begin(), request.m_masks.end());
+        }
+
+        try {
+            Output outputs = m_network->evaluate(states, masks);
+
+            m_numEvals += states.size();
+            ++m_numBatches;
+
+            auto readIt = outputs.begin();
+            for (Request& request : batch) {
+                auto endIt = readIt + request.m_states.size();
+                request.m_promise.set_value(Output(readIt, endIt));
+                readIt = endIt;
+            }
+
+        } catch (...) {
+            for (Request& request : batch) {
+                request.m_promise.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    INetwork<State, ACTION_SIZE>* m_network;
+
+    int m_maxBatchSize;
+    std::chrono::microseconds m_maxWait;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request> m_queue;  // Pending requests, oldest first.
+    int m_numQueuedStates { 0 };  // Total number of states across pending requests.
+    bool m_stopping { false };
+
+    std::atomic<int> m_numEvals { 0 };
+    std::atomic<int> m_numBatches { 0 };
+
+    std::thread m_thread;  // Declared last, so it starts after everything else is initialized.
+};
+
+} // namespace SPRL
+
+#endif
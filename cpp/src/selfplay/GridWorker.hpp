@@ -4,7 +4,9 @@
 #include "../games/GridState.hpp"
 
 #include "../networks/INetwork.hpp"
+#include "../networks/CachedNetwork.hpp"
 #include "../networks/GridNetwork.hpp"
+#include "../networks/InferenceService.hpp"
 #include "../networks/RandomNetwork.hpp"
 
 #include "../selfplay/SelfPlay.hpp"
@@ -13,8 +15,10 @@
 
 #include "../constants.hpp"
 
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <thread>
 
@@ -80,6 +84,30 @@ std::string waitModelPath(int iteration, const std::string& runName) {
  * @param maxQueueSize The maximum number of states to evaluate per batch of search.
  * @param dirEps The epsilon value for the Dirichlet noise.
  * @param dirAlpha The alpha value for the Dirichlet noise.
+ * @param numSearchThreads The number of threads to run tree-parallel search with, per game.
+ * @param numParallelGames The number of games to play concurrently. If greater than one,
+ *                         their network requests are funnelled through an `InferenceService`.
+ * @param inferenceBatchSize The batch size at which the inference service evaluates immediately.
+ * @param inferenceMaxWaitMicros The longest the inference service waits for a batch to fill up.
+ * @param transpositions How the search exploits transposed positions.
+ * @param log2EvalCacheSize The base-2 logarithm of the number of entries in the evaluation
+ *                          cache shared by all games of an iteration, or zero for no cache.
+ * @param maxTreeNodes The most nodes to keep in the search tree of each game, or zero for no limit.
+ * @param pipelineSearch Whether each search overlaps leaf selection with network evaluation.
+ * @param numFastTraversals For playout cap randomization, the number of UCT traversals
+ *                          of the cheap searches, or zero to search every move in full.
+ * @param fullSearchProb For playout cap randomization, the probability that a move is searched in full.
+ *                       Which samples were is saved alongside the data, as policy target weights.
+ * @param numRootTrees The number of independent trees to search each move with, per game.
+ *                     If greater than one, they also share an `InferenceService`.
+ * @param tuneQueueSize Whether to tune the queue size of the searches while they run, starting
+ *                      from `maxQueueSize` in every iteration, and log the results to pin them.
+ * @param maxTunedQueueSize The largest queue size to tune up to.
+ * @param maxCollisionRate The largest fraction of leaf selections per batch the tuning allows to collide.
+ * @param solver Whether the searches prove positions won, lost, or drawn, and play by the proofs.
+ * @param numGumbelActions The number of actions to sample per move for Gumbel search, or zero for PUCT.
+ * @param speculativeFill Whether the searches top up short batches with speculative leaves.
+ * @param pruneWidth The number of moves the searches consider below the root before unpruning, or zero for all.
  */
 template <typename NeuralNetwork, typename ImplNode, int NUM_ROWS, int NUM_COLS, int HISTORY_SIZE, int ACTION_SIZE>
 void runWorker(std::string runName, std::string saveDir,
@@ -88,7 +116,14 @@ void runWorker(std::string runName, std::string saveDir,
                int numIters,
                int initNumGamesPerWorker, int initUctTraversals, int initMaxBatchSize, int initMaxQueueSize,
                int numGamesPerWorker, int uctTraversals, int maxBatchSize, int maxQueueSize,
-               float dirEps, float dirAlpha) {
+               float dirEps, float dirAlpha, int numSearchThreads = 1,
+               int numParallelGames = 1, int inferenceBatchSize = 256, int inferenceMaxWaitMicros = 1000,
+               Transpositions transpositions = Transpositions::NONE, int log2EvalCacheSize = 0,
+               size_t maxTreeNodes = 0, bool pipelineSearch = false,
+               int numFastTraversals = 0, float fullSearchProb = 1.0f, int numRootTrees = 1,
+               bool tuneQueueSize = false, int maxTunedQueueSize = 64, float maxCollisionRate = 0.1f,
+               bool solver = false, int numGumbelActions = 0, bool speculativeFill = false,
+               int pruneWidth = 0) {
 
     using State = GridState<NUM_ROWS * NUM_COLS, HISTORY_SIZE>;
     using ActionDist = GameActionDist<ACTION_SIZE>;
@@ -115,10 +150,10 @@ void runWorker(std::string runName, std::string saveDir,
         std::string modelPath = waitModelPath(iter - 1, runName);
         std::string savePath = saveDir + "/" + runName + "_iteration_" + std::to_string(iter);
 
-        int numGames      = (iter == 0) ? initNumGamesPerWorker : numGamesPerWorker;
-        int numTraversals = (iter == 0) ? initUctTraversals : uctTraversals;
-        int maxBatchSize  = (iter == 0) ? initMaxBatchSize : maxBatchSize;
-        int maxQueueSize  = (iter == 0) ? initMaxQueueSize : maxQueueSize;
+        int numGames         = (iter == 0) ? initNumGamesPerWorker : numGamesPerWorker;
+        int numTraversals    = (iter == 0) ? initUctTraversals : uctTraversals;
+        int iterMaxBatchSize = (iter == 0) ? initMaxBatchSize : maxBatchSize;
+        int iterMaxQueueSize = (iter == 0) ? initMaxQueueSize : maxQueueSize;
 
         NeuralNetwork neuralNetwork { modelPath };
 
@@ -130,19 +165,69 @@ void runWorker(std::string runName, std::string saveDir,
             network = &neuralNetwork;
         }
 
-        auto [states, distributions, outcomes] = runIteration<ImplNode, State, ACTION_SIZE>(
+        // Coalesce the requests of concurrent games into large batches. Constructed
+        // per iteration, so that it never outlives the network it wraps.
+        std::optional<InferenceService<State, ACTION_SIZE>> inferenceService;
+
+        if (numParallelGames > 1 || numRootTrees > 1) {
+            inferenceService.emplace(network, inferenceBatchSize,
+                                     std::chrono::microseconds { inferenceMaxWaitMicros });
+            network = &*inferenceService;
+        }
+
+        // Remember evaluations across the games of the iteration. Also constructed per
+        // iteration, so that it is invalidated whenever a new model is loaded.
+        std::optional<CachedNetwork<NUM_ROWS * NUM_COLS, HISTORY_SIZE, ACTION_SIZE>> cachedNetwork;
+
+        if (log2EvalCacheSize > 0) {
+            cachedNetwork.emplace(network, log2EvalCacheSize, symmetrizer);
+            network = &*cachedNetwork;
+        }
+
+        std::optional<BatchSizeTuner> batchSizeTuner;
+
+        if (tuneQueueSize) {
+            batchSizeTuner.emplace(iterMaxQueueSize, 1, maxTunedQueueSize, maxCollisionRate);
+        }
+
+        auto [states, distributions, outcomes, fullSearches] = runIteration<ImplNode, State, ACTION_SIZE>(
             network,
             numGames,
             numTraversals,
-            maxBatchSize,
-            maxQueueSize,
+            iterMaxBatchSize,
+            iterMaxQueueSize,
             dirEps,
             dirAlpha,
-            InitQ::PARENT,
             symmetrizer,
-            true
+            true,
+            numSearchThreads,
+            numParallelGames,
+            transpositions,
+            maxTreeNodes,
+            pipelineSearch,
+            numFastTraversals,
+            fullSearchProb,
+            numRootTrees,
+            batchSizeTuner ? &*batchSizeTuner : nullptr,
+            solver,
+            numGumbelActions,
+            speculativeFill,
+            pruneWidth
         );
 
+        if (batchSizeTuner) {
+            std::cout << "Tuned queue size: " << batchSizeTuner->getQueueSize()
+                      << ", best " << batchSizeTuner->getBestQueueSize()
+                      << " at " << batchSizeTuner->getBestLeavesPerSecond() << " leaves/s"
+                      << ", collision rate " << batchSizeTuner->getCollisionRate()
+                      << ", network latency " << batchSizeTuner->getEvalLatency() * 1000.0 << " ms." << std::endl;
+        }
+
+        if (cachedNetwork) {
+            std::cout << "Evaluation cache hits: " << cachedNetwork->getNumHits()
+                      << " of " << cachedNetwork->getNumLookups() << " lookups." << std::endl;
+        }
+
         std::vector<float> embeddedStates;
 
         for (const State& state : states) {
@@ -189,6 +274,12 @@ void runWorker(std::string runName, std::string saveDir,
 
         npy::write_npy(savePath + "_distributions.npy", distData);
 
+        npy::npy_data_ptr<float> fullSearchData {};
+        fullSearchData.data_ptr = fullSearches.data();
+        fullSearchData.shape = { static_cast<unsigned long>(fullSearches.size()) };
+
+        npy::write_npy(savePath + "_full_searches.npy", fullSearchData);
+
         npy::npy_data_ptr<float> outcomeData {};
         outcomeData.data_ptr = outcomes.data();
         outcomeData.shape = { static_cast<unsigned long>(outcomes.size()) };
@@ -10,6 +10,7 @@
 #include "../games/GameNode.hpp"
 #include "../networks/INetwork.hpp"
 #include "../symmetry/ISymmetrizer.hpp"
+#include "../uct/RootParallelTree.hpp"
 #include "../uct/UCTTree.hpp"
 
 #include "../utils/random.hpp"
@@ -17,8 +18,11 @@
 
 #include "../constants.hpp"
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace SPRL {
 
@@ -28,6 +32,7 @@ namespace SPRL {
  * @tparam ImplNode The implementation of the game node, e.g. `GoNode`.
  * @tparam State The state of the game, e.g. `GridState`.
  * @tparam ACTION_SIZE The size of the action space.
+ * @tparam INIT_Q The method to initialize the Q values.
  * 
  * @param rootNode The root node of the game tree.
  * @param network The neural network to use for evaluation.
@@ -36,30 +41,57 @@ namespace SPRL {
  * @param maxQueueSize The maximum number of states to evaluate per batch of search.
  * @param dirEps The epsilon value for the Dirichlet noise.
  * @param dirAlpha The alpha value for the Dirichlet noise.
- * @param initQMethod The method to initialize the Q values.
  * @param symmetrizer The symmetrizer to use for symmetrizing the network and data (or nullptr).
  * @param addNoise Whether to add Dirichlet noise to the root node.
+ * @param numSearchThreads The number of threads to run tree-parallel search with.
+ * @param transpositions How the search exploits transposed positions.
+ * @param maxTreeNodes The most nodes to keep in the search tree, or zero for no limit.
+ * @param pipelineSearch Whether to overlap leaf selection with network evaluation.
+ * @param numFastTraversals For playout cap randomization, the number of UCT traversals
+ *                          of the cheap searches, or zero to search every move in full.
+ * @param fullSearchProb For playout cap randomization, the probability that a move is searched
+ *                       in full, with noise, and used as a policy target.
+ * @param numRootTrees The number of independent trees to search each move with, on a thread each,
+ *                     splitting the traversals between them and summing their root visits.
+ *                     The extra trees start from a new `ImplNode`, so the game must start there too.
+ * @param batchSizeTuner The tuner to size the batches of search with, or nullptr to use
+ *                       `maxBatchSize` and `maxQueueSize` as they are.
+ * @param solver Whether the search proves positions won, lost, or drawn, and plays by the proofs.
+ * @param numGumbelActions The number of actions to sample per move for Gumbel search, whose
+ *                         improved policies become the targets and which picks the moves itself,
+ *                         or zero for PUCT with Dirichlet noise and visit count targets.
+ * @param speculativeFill Whether to top up batches short of the queue size with speculative leaves.
+ * @param pruneWidth The number of moves, by policy, that the search considers below the root
+ *                   before progressive unpruning, or zero for all of them.
  * 
  * @returns A tuple of:
  *     1. A vector of states, where each state is a symmetrized version of the game state over time.
  *     2. A vector of action distributions, where each distribution is a symmetrized version
- *        of the action distribution produced by UCT.
+ *        of the action distribution produced by UCT, or all zeros after a cheap search.
  *     3. A vector of outcomes, where each outcome is the reward for the corresponding player
  *        that took an action at any given state.
+ *     4. A vector of flags, 1 where the move was searched in full, so that its distribution
+ *        is a policy target, and 0 where it only serves as a value target.
 */
-template <typename ImplNode, typename State, int ACTION_SIZE>
-std::tuple<std::vector<State>, std::vector<GameActionDist<ACTION_SIZE>>, std::vector<Value>>
+template <typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q = InitQ::PARENT>
+std::tuple<std::vector<State>, std::vector<GameActionDist<ACTION_SIZE>>, std::vector<Value>, std::vector<float>>
 selfPlay(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode,
          INetwork<State, ACTION_SIZE>* network,
          int numTraversals, int maxBatchSize, int maxQueueSize,
-         float dirEps, float dirAlpha, InitQ initQMethod,
-         ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true) {
+         float dirEps, float dirAlpha,
+         ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true,
+         int numSearchThreads = 1, Transpositions transpositions = Transpositions::NONE,
+         size_t maxTreeNodes = 0, bool pipelineSearch = false,
+         int numFastTraversals = 0, float fullSearchProb = 1.0f, int numRootTrees = 1,
+         BatchSizeTuner* batchSizeTuner = nullptr, bool solver = false, int numGumbelActions = 0,
+         bool speculativeFill = false, int pruneWidth = 0) {
 
     using ActionDist = GameActionDist<ACTION_SIZE>;
 
     std::vector<State> states;
     std::vector<ActionDist> distributions;
     std::vector<Value> outcomes;
+    std::vector<float> fullSearches;
     std::vector<Player> players;
 
     std::vector<SymmetryIdx> allSymmetries;  // Contains all symmetries if symmetrizer exists.
@@ -70,16 +102,29 @@ selfPlay(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode,
         }
     }
 
-    // Initialize the UCT tree.
-    UCTTree<ImplNode, State, ACTION_SIZE> tree {
-        std::move(rootNode),
+    // Initialize the UCT trees, all from the same position.
+    std::vector<std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>>> rootNodes;
+    rootNodes.push_back(std::move(rootNode));
+
+    for (int k = 1; k < numRootTrees; ++k) {
+        rootNodes.push_back(std::make_unique<ImplNode>());
+    }
+
+    RootParallelTree<ImplNode, State, ACTION_SIZE, INIT_Q> tree {
+        std::move(rootNodes),
         dirEps,
         dirAlpha,
-        initQMethod,
         symmetrizer,
-        addNoise
+        addNoise,
+        transpositions,
+        maxTreeNodes,
+        solver
     };
 
+    tree.setBatchSizeTuner(batchSizeTuner);
+    tree.setSpeculativeFill(speculativeFill);
+    tree.setPruneWidth(pruneWidth);
+
     int moveCount = 0;
 
     while (!tree.getDecisionNode()->isTerminal()) {
@@ -95,34 +140,56 @@ selfPlay(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode,
             states.push_back(tree.getDecisionNode()->getGameState());
         }
 
-        // Perform `numTraversals` many search iterations.
-        int traversals = 0;
-        while (traversals < numTraversals) {
-            auto [leaves, trav] = tree.searchAndGetLeaves(maxBatchSize, maxQueueSize, network, U_WEIGHT);
+        // Playout cap randomization: most moves only get a cheap search without noise, too weak
+        // for a policy target, but they still play the game out and so yield value targets.
+        bool fullSearch = (numFastTraversals <= 0) || (GetRandom()() < fullSearchProb);
 
-            if (leaves.size() > 0) {
-                tree.evaluateAndBackpropLeaves(leaves, network);
-            }
+        ActionDist pdf;
+        int action;
 
-            traversals += trav;
-        }
+        if (numGumbelActions > 0) {
+            // Gumbel noise takes the place of Dirichlet noise, and picks the move too.
+            tree.setAddNoise(false);
+            tree.searchGumbel(fullSearch ? numTraversals : numFastTraversals, numGumbelActions,
+                              maxBatchSize, maxQueueSize, network, U_WEIGHT, numSearchThreads, pipelineSearch);
 
-        // Generate a PDF from the visit counts.
-        ActionDist visits = tree.getDecisionNode()->getEdgeStatistics()->m_numVisits;
-        ActionDist pdf = visits / visits.sum();
+            pdf = tree.getImprovedPolicy();
+            action = tree.getGumbelAction();
 
-        // Raise it to 0.98f (temp ~ 1) if early game, else 10.0f (temp -> 0), then renormalize.
-        if (moveCount < EARLY_GAME_CUTOFF) {
-            pdf = pdf.pow(EARLY_GAME_EXP);
         } else {
-            pdf = pdf.pow(REST_GAME_EXP);
-        }
+            tree.setAddNoise(addNoise && fullSearch);
+
+            // Perform `numTraversals` many search iterations, or `numFastTraversals` for a cheap search.
+            // Cheap searches are no policy targets, so may stop once their most visited move is decided.
+            tree.search(fullSearch ? numTraversals : numFastTraversals,
+                        maxBatchSize, maxQueueSize, network, U_WEIGHT, numSearchThreads, pipelineSearch,
+                        !fullSearch);
 
-        pdf = pdf / pdf.sum();
+            // Generate a PDF from the visit counts, merged over the trees, and played by the proofs with the solver on.
+            ActionDist visits = tree.getRootVisits();
+            pdf = visits / visits.sum();
 
-        // Generate a CDF from the PDF.
-        ActionDist cdf = pdf.cumsum();
-        cdf = cdf / cdf[ACTION_SIZE - 1];
+            // Raise it to 0.98f (temp ~ 1) if early game, else 10.0f (temp -> 0), then renormalize.
+            if (moveCount < EARLY_GAME_CUTOFF) {
+                pdf = pdf.pow(EARLY_GAME_EXP);
+            } else {
+                pdf = pdf.pow(REST_GAME_EXP);
+            }
+
+            pdf = pdf / pdf.sum();
+
+            // Generate a CDF from the PDF, and sample from it.
+            ActionDist cdf = pdf.cumsum();
+            cdf = cdf / cdf[ACTION_SIZE - 1];
+
+            action = GetRandom().SampleCDF(&cdf[0], ACTION_SIZE);
+        }
+
+        // Cheap searches record no policy target: an all-zero distribution, which the cross-entropy
+        // policy loss gives no weight, so training need not read the flags to leave them out.
+        if (!fullSearch) {
+            pdf = ActionDist {};
+        }
 
         if (symmetrizer != nullptr) {
             // Symmetrize the distributions and add to data.
@@ -136,11 +203,10 @@ selfPlay(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode,
             distributions.push_back(pdf);
         }
 
-        // Sample from the CDF.
-        int action = GetRandom().SampleCDF(std::vector<float>(cdf.begin(), cdf.end()));
-
-        // Record the player that just took the action.
+        // Record the player that just took the action, and whether the move is a policy target.
         players.push_back(tree.getDecisionNode()->getPlayer());
+        fullSearches.insert(fullSearches.end(), allSymmetries.empty() ? 1 : allSymmetries.size(),
+                            fullSearch ? 1.0f : 0.0f);
 
         // Play the action by rerooting the tree and updating the state.
         tree.advanceDecision(action);
@@ -188,7 +254,7 @@ selfPlay(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode,
         }
     }
 
-    return { states, distributions, outcomes };
+    return { states, distributions, outcomes, fullSearches };
 }
 
 /**
@@ -198,53 +264,112 @@ selfPlay(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode,
  * @tparam State The state of the game, e.g. `GridState`.
  * @tparam ACTION_SIZE The size of the action space.
  * 
- * @note See `selfPlay()` for more details.
+ * @param numParallelGames The number of games to play concurrently, each on its own thread.
+ * If greater than one, the network must be thread-safe, e.g. an `InferenceService`
+ * that coalesces the requests of all the games into large batches.
+ * 
+ * @note See `selfPlay()` for more details. A batch size tuner is shared by all the games. The data is collated in game order
+ * regardless of the order in which concurrent games finish.
 */
-template <typename ImplNode, typename State, int ACTION_SIZE>
-std::tuple<std::vector<State>, std::vector<GameActionDist<ACTION_SIZE>>, std::vector<Value>>
+template <typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q = InitQ::PARENT>
+std::tuple<std::vector<State>, std::vector<GameActionDist<ACTION_SIZE>>, std::vector<Value>, std::vector<float>>
 runIteration(INetwork<State, ACTION_SIZE>* network, int numGames,
              int numTraversals, int maxBatchSize, int maxQueueSize,
-             float dirEps, float dirAlpha, InitQ initQMethod,
-             ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true) {
+             float dirEps, float dirAlpha,
+             ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true,
+             int numSearchThreads = 1, int numParallelGames = 1,
+             Transpositions transpositions = Transpositions::NONE, size_t maxTreeNodes = 0,
+             bool pipelineSearch = false, int numFastTraversals = 0, float fullSearchProb = 1.0f,
+             int numRootTrees = 1, BatchSizeTuner* batchSizeTuner = nullptr, bool solver = false,
+             int numGumbelActions = 0, bool speculativeFill = false, int pruneWidth = 0) {
 
     using ActionDist = GameActionDist<ACTION_SIZE>;
+    using GameData = std::tuple<std::vector<State>, std::vector<ActionDist>, std::vector<Value>, std::vector<float>>;
+
+    assert(numParallelGames <= 1 || network->isThreadSafe());
+
+    std::vector<GameData> gameData (numGames);
+
+    std::atomic<int> nextGame { 0 };
+
+    std::mutex logMutex;
+    int numGamesPlayed = 0;
+    size_t numStatesCollected = 0;
+
+    auto playGames = [&]() {
+        int t;
+        while ((t = nextGame.fetch_add(1)) < numGames) {
+            std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode = std::make_unique<ImplNode>();
+
+            gameData[t] = selfPlay<ImplNode, State, ACTION_SIZE, INIT_Q>(
+                std::move(rootNode),
+                network,
+                numTraversals,
+                maxBatchSize,
+                maxQueueSize,
+                dirEps,
+                dirAlpha,
+                symmetrizer,
+                addNoise,
+                numSearchThreads,
+                transpositions,
+                maxTreeNodes,
+                pipelineSearch,
+                numFastTraversals,
+                fullSearchProb,
+                numRootTrees,
+                batchSizeTuner,
+                solver,
+                numGumbelActions,
+                speculativeFill,
+                pruneWidth
+            );
+
+            std::lock_guard<std::mutex> guard { logMutex };
+
+            numStatesCollected += std::get<0>(gameData[t]).size();
+            std::cout << ++numGamesPlayed << " games played, " << numStatesCollected << " states collected.\n";
+        }
+    };
+
+    if (numParallelGames <= 1) {
+        playGames();
+
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(numParallelGames);
+
+        for (int i = 0; i < numParallelGames; ++i) {
+            threads.emplace_back(playGames);
+        }
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
 
     std::vector<State> allStates;
     std::vector<ActionDist> allDistributions;
     std::vector<Value> allOutcomes;
+    std::vector<float> allFullSearches;
 
-    for (int t = 0; t < numGames; ++t) {
-        std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> rootNode = std::make_unique<ImplNode>();
-
-        auto [states, distributions, outcomes] = selfPlay(
-            std::move(rootNode),
-            network,
-            numTraversals,
-            maxBatchSize,
-            maxQueueSize,
-            dirEps,
-            dirAlpha,
-            initQMethod,
-            symmetrizer,
-            addNoise
-        );
-
-        allStates.reserve(allStates.size() + states.size());
-        allStates.insert(allStates.end(), states.begin(), states.end());
+    allStates.reserve(numStatesCollected);
+    allDistributions.reserve(numStatesCollected);
+    allOutcomes.reserve(numStatesCollected);
+    allFullSearches.reserve(numStatesCollected);
 
-        allDistributions.reserve(allDistributions.size() + distributions.size());
+    for (auto& [states, distributions, outcomes, fullSearches] : gameData) {
+        allStates.insert(allStates.end(), states.begin(), states.end());
         allDistributions.insert(allDistributions.end(), distributions.begin(), distributions.end());
-
-        allOutcomes.reserve(allOutcomes.size() + outcomes.size());
         allOutcomes.insert(allOutcomes.end(), outcomes.begin(), outcomes.end());
-
-        std::cout << t + 1 << " games played, " << allStates.size() << " states collected.\n";
+        allFullSearches.insert(allFullSearches.end(), fullSearches.begin(), fullSearches.end());
     }
 
     assert(allStates.size() == allDistributions.size());
     assert(allStates.size() == allOutcomes.size());
+    assert(allStates.size() == allFullSearches.size());
 
-    return { allStates, allDistributions, allOutcomes };
+    return { allStates, allDistributions, allOutcomes, allFullSearches };
 }
 
 } // namespace SPRL
@@ -20,44 +20,7 @@ std::vector<ConnectFourSymmetrizer::State> ConnectFourSymmetrizer::symmetrizeSta
     symmetrizedStates.reserve(symmetries.size());
 
     for (SymmetryIdx symmetry : symmetries) {
-        switch (symmetry) {
-        case 0: {
-            // The identity symmetry.
-            symmetrizedStates.push_back(state);
-            break;
-        }
-
-        case 1: {
-            // The vertical flip symmetry.
-            std::array<Board, C4_HISTORY_SIZE> symmetrizedBoards;
-            auto history = state.getHistory();
-
-            // There should be exactly one valid board in history.
-            assert(state.size() == C4_HISTORY_SIZE);
-
-            for (int idx = 0; idx < state.size(); ++idx) {
-                Board symmetrizedBoard = history[idx];  // Copy the board.
-
-                // Perform a vertical flip on the board.
-                for (int i = 0; i < C4_NUM_ROWS; ++i) {
-                    for (int j = 0; j < C4_NUM_COLS / 2; ++j) {
-                        int idx1 = ConnectFourNode::toIndex(i, j);
-                        int idx2 = ConnectFourNode::toIndex(i, C4_NUM_COLS - 1 - j);
-                        std::swap(symmetrizedBoard[idx1], symmetrizedBoard[idx2]);
-                    }
-                }
-
-                symmetrizedBoards[idx] = std::move(symmetrizedBoard);
-            }
-
-            symmetrizedStates.push_back(State {
-                std::move(symmetrizedBoards), C4_HISTORY_SIZE, state.getPlayer() });
-            break;
-        }
-        
-        default:
-            assert(false);
-        }
+        symmetrizedStates.push_back(symmetrizeSingleState(state, symmetry));
     }
 
     return symmetrizedStates;
@@ -71,32 +34,76 @@ std::vector<ConnectFourSymmetrizer::ActionDist> ConnectFourSymmetrizer::symmetri
     symmetrizedActionDists.reserve(symmetries.size());
 
     for (SymmetryIdx symmetry : symmetries) {
-        switch (symmetry) {
-        case 0: {
-            // The identity symmetry.
-            symmetrizedActionDists.push_back(actionDist);
-            break;
-        }
+        symmetrizedActionDists.push_back(symmetrizeSingleActionDist(actionDist, symmetry));
+    }
+
+    return symmetrizedActionDists;
+}
+
+ConnectFourSymmetrizer::State ConnectFourSymmetrizer::symmetrizeSingleState(
+    const State& state, SymmetryIdx symmetry) const {
 
-        case 1: {
-            // The vertical flip symmetry.
-            ActionDist symmetrizedActionDist = actionDist;  // Copy the action distribution.
+    switch (symmetry) {
+    case 0:
+        // The identity symmetry.
+        return state;
 
-            // Perform a vertical flip on the action distribution.
-            for (int i = 0; i < C4_NUM_COLS / 2; ++i) {
-                std::swap(symmetrizedActionDist[i], symmetrizedActionDist[C4_NUM_COLS - 1 - i]);
+    case 1: {
+        // The vertical flip symmetry.
+        std::array<Board, C4_HISTORY_SIZE> symmetrizedBoards;
+        const auto& history = state.getHistory();
+
+        // There should be exactly one valid board in history.
+        assert(state.size() == C4_HISTORY_SIZE);
+
+        for (int idx = 0; idx < state.size(); ++idx) {
+            Board symmetrizedBoard = history[idx];  // Copy the board.
+
+            // Perform a vertical flip on the board.
+            for (int i = 0; i < C4_NUM_ROWS; ++i) {
+                for (int j = 0; j < C4_NUM_COLS / 2; ++j) {
+                    int idx1 = ConnectFourNode::toIndex(i, j);
+                    int idx2 = ConnectFourNode::toIndex(i, C4_NUM_COLS - 1 - j);
+                    std::swap(symmetrizedBoard[idx1], symmetrizedBoard[idx2]);
+                }
             }
 
-            symmetrizedActionDists.push_back(symmetrizedActionDist);
-            break;
+            symmetrizedBoards[idx] = std::move(symmetrizedBoard);
         }
-        
-        default:
-            assert(false);
+
+        return State { std::move(symmetrizedBoards), C4_HISTORY_SIZE, state.getPlayer() };
+    }
+
+    default:
+        assert(false);
+        return state;
+    }
+}
+
+ConnectFourSymmetrizer::ActionDist ConnectFourSymmetrizer::symmetrizeSingleActionDist(
+    const ActionDist& actionDist, SymmetryIdx symmetry) const {
+
+    switch (symmetry) {
+    case 0:
+        // The identity symmetry.
+        return actionDist;
+
+    case 1: {
+        // The vertical flip symmetry.
+        ActionDist symmetrizedActionDist = actionDist;  // Copy the action distribution.
+
+        // Perform a vertical flip on the action distribution.
+        for (int i = 0; i < C4_NUM_COLS / 2; ++i) {
+            std::swap(symmetrizedActionDist[i], symmetrizedActionDist[C4_NUM_COLS - 1 - i]);
         }
+
+        return symmetrizedActionDist;
     }
 
-    return symmetrizedActionDists;
+    default:
+        assert(false);
+        return actionDist;
+    }
 }
 
-} // namespace SPRL
\ No newline at end of file
+} // namespace SPRL
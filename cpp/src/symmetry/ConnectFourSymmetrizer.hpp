@@ -24,6 +24,10 @@ public:
 
     std::vector<ActionDist> symmetrizeActionDist(const ActionDist& actionDist,
                                                  const std::vector<SymmetryIdx>& symmetries) const override;
+
+    State symmetrizeSingleState(const State& state, SymmetryIdx symmetry) const override;
+
+    ActionDist symmetrizeSingleActionDist(const ActionDist& actionDist, SymmetryIdx symmetry) const override;
 };
 
 } // namespace SPRL
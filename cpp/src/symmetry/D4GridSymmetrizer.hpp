@@ -56,22 +56,27 @@ public:
         std::vector<State> symmetriesStates;
         symmetriesStates.reserve(symmetries.size());
 
-        std::array<Board, HISTORY_SIZE> history = state.getHistory();
-
         for (SymmetryIdx symmetry : symmetries) {
-            std::array<Board, HISTORY_SIZE> symmetrizedHistory;
-            for (int t = 0; t < state.size(); ++t) {
-                for (int fromRow = 0; fromRow < BOARD_WIDTH; ++fromRow) {
-                    for (int fromCol = 0; fromCol < BOARD_WIDTH; ++fromCol) {
-                        auto [toRow, toCol] = s_symmetrizeFunctions[symmetry](fromRow, fromCol);
-                        symmetrizedHistory[t][toIndex(toRow, toCol)] = history[t][toIndex(fromRow, fromCol)];
-                    }
+            symmetriesStates.push_back(symmetrizeSingleState(state, symmetry));
+        }
+
+        return symmetriesStates;
+    }
+
+    State symmetrizeSingleState(const State& state, SymmetryIdx symmetry) const override {
+        const std::array<Board, HISTORY_SIZE>& history = state.getHistory();
+
+        std::array<Board, HISTORY_SIZE> symmetrizedHistory;
+        for (int t = 0; t < state.size(); ++t) {
+            for (int fromRow = 0; fromRow < BOARD_WIDTH; ++fromRow) {
+                for (int fromCol = 0; fromCol < BOARD_WIDTH; ++fromCol) {
+                    auto [toRow, toCol] = s_symmetrizeFunctions[symmetry](fromRow, fromCol);
+                    symmetrizedHistory[t][toIndex(toRow, toCol)] = history[t][toIndex(fromRow, fromCol)];
                 }
             }
-            symmetriesStates.push_back(State { std::move(symmetrizedHistory), state.size(), state.getPlayer() });            
         }
 
-        return symmetriesStates;
+        return State { std::move(symmetrizedHistory), state.size(), state.getPlayer() };
     }
 
     std::vector<ActionDist> symmetrizeActionDist(
@@ -82,22 +87,26 @@ public:
         symmetrizedActionDists.reserve(symmetries.size());
 
         for (SymmetryIdx symmetry : symmetries) {
-            ActionDist symmetrizedActionDist;
+            symmetrizedActionDists.push_back(symmetrizeSingleActionDist(actionDist, symmetry));
+        }
 
-            for (int fromRow = 0; fromRow < BOARD_WIDTH; ++fromRow) {
-                for (int fromCol = 0; fromCol < BOARD_WIDTH; ++fromCol) {
-                    auto [toRow, toCol] = s_symmetrizeFunctions[symmetry](fromRow, fromCol);
-                    symmetrizedActionDist[toIndex(toRow, toCol)] = actionDist[toIndex(fromRow, fromCol)];
-                }
+        return symmetrizedActionDists;
+    }
+
+    ActionDist symmetrizeSingleActionDist(const ActionDist& actionDist, SymmetryIdx symmetry) const override {
+        ActionDist symmetrizedActionDist;
+
+        for (int fromRow = 0; fromRow < BOARD_WIDTH; ++fromRow) {
+            for (int fromCol = 0; fromCol < BOARD_WIDTH; ++fromCol) {
+                auto [toRow, toCol] = s_symmetrizeFunctions[symmetry](fromRow, fromCol);
+                symmetrizedActionDist[toIndex(toRow, toCol)] = actionDist[toIndex(fromRow, fromCol)];
             }
-            
-            // Pass action.
-            symmetrizedActionDist[BOARD_WIDTH * BOARD_WIDTH] = actionDist[BOARD_WIDTH * BOARD_WIDTH];
-            
-            symmetrizedActionDists.push_back(symmetrizedActionDist);
         }
 
-        return symmetrizedActionDists;
+        // Pass action.
+        symmetrizedActionDist[BOARD_WIDTH * BOARD_WIDTH] = actionDist[BOARD_WIDTH * BOARD_WIDTH];
+
+        return symmetrizedActionDist;
     }
 
 private:
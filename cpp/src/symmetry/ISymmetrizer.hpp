@@ -51,6 +51,32 @@ public:
     */
     virtual std::vector<ActionDist> symmetrizeActionDist(const ActionDist& actionDist,
                                                          const std::vector<SymmetryIdx>& symmetries) const = 0;
+
+    /**
+     * Like `symmetrizeState`, for a single symmetry, without allocating.
+     * Symmetrizers should override it, as the default goes through the vector version.
+     * 
+     * @param state The state to symmetrize.
+     * @param symmetry The symmetry to apply, in range `[0, numSymmetries())`.
+     * 
+     * @returns The symmetrized state.
+    */
+    virtual State symmetrizeSingleState(const State& state, SymmetryIdx symmetry) const {
+        return symmetrizeState(state, { symmetry })[0];
+    }
+
+    /**
+     * Like `symmetrizeActionDist`, for a single symmetry, without allocating.
+     * Symmetrizers should override it, as the default goes through the vector version.
+     * 
+     * @param actionDist The action distribution to symmetrize.
+     * @param symmetry The symmetry to apply, in range `[0, numSymmetries())`.
+     * 
+     * @returns The symmetrized action distribution.
+    */
+    virtual ActionDist symmetrizeSingleActionDist(const ActionDist& actionDist, SymmetryIdx symmetry) const {
+        return symmetrizeActionDist(actionDist, { symmetry })[0];
+    }
 };
 
 } // namespace SPRL
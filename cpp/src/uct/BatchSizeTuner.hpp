@@ -0,0 +1,166 @@
+#ifndef SPRL_BATCH_SIZE_TUNER_HPP
+#define SPRL_BATCH_SIZE_TUNER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace SPRL {
+
+/**
+ * Tunes the number of leaves searches queue per network batch, while they run.
+ *
+ * Larger batches use the network more efficiently, but the more leaves are selected
+ * before any is evaluated, the more the selections collide on the same leaf and the
+ * more they drift from what sequential search would have picked. The tuner climbs
+ * towards the queue size that evaluates the most unique leaves per second, backing
+ * off whenever the fraction of colliding selections exceeds a ceiling.
+ *
+ * Searches report each batch, and the queue size moves after every window of batches:
+ * on in the same direction while the throughput improves, and back otherwise. Any
+ * number of searches, on any threads, can share a tuner.
+*/
+class BatchSizeTuner {
+public:
+    /**
+     * @param initQueueSize The queue size to start from.
+     * @param minQueueSize The smallest queue size to try.
+     * @param maxQueueSize The largest queue size to try.
+     * @param maxCollisionRate The largest fraction of selections allowed to collide.
+     * @param windowBatches The number of batches to measure each queue size over.
+    */
+    BatchSizeTuner(int initQueueSize, int minQueueSize, int maxQueueSize,
+                   float maxCollisionRate = 0.1f, int windowBatches = 32)
+        : m_minQueueSize { minQueueSize }, m_maxQueueSize { maxQueueSize },
+          m_maxCollisionRate { maxCollisionRate }, m_windowBatches { windowBatches },
+          m_queueSize { std::clamp(initQueueSize, minQueueSize, maxQueueSize) },
+          m_bestQueueSize { m_queueSize.load() } {
+    }
+
+    /**
+     * @returns The number of leaves to queue per batch.
+    */
+    int getQueueSize() const {
+        return m_queueSize.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Records a batch of search.
+     *
+     * @param numLeaves The number of leaves selected for evaluation, with repeats.
+     * @param numUniqueLeaves The number of distinct leaves evaluated.
+     * @param batchSeconds The time taken by the whole batch, from selection to backup.
+     * @param evalSeconds The time spent waiting on the network.
+    */
+    void report(int numLeaves, int numUniqueLeaves, double batchSeconds, double evalSeconds) {
+        std::lock_guard<std::mutex> lock { m_mutex };
+
+        m_windowLeaves += numLeaves;
+        m_windowUniqueLeaves += numUniqueLeaves;
+        m_windowSeconds += batchSeconds;
+        m_windowEvalSeconds += evalSeconds;
+
+        if (++m_windowBatchCount < m_windowBatches) {
+            return;
+        }
+
+        m_leavesPerSecond = (m_windowSeconds > 0.0) ? m_windowUniqueLeaves / m_windowSeconds : 0.0;
+        m_collisionRate = (m_windowLeaves > 0) ? 1.0 - static_cast<double>(m_windowUniqueLeaves) / m_windowLeaves : 0.0;
+        m_evalLatency = m_windowEvalSeconds / m_windowBatchCount;
+
+        int queueSize = m_queueSize.load(std::memory_order_relaxed);
+
+        if (m_collisionRate > m_maxCollisionRate) {
+            m_direction = -1;
+        } else {
+            if (m_leavesPerSecond > m_bestLeavesPerSecond) {
+                m_bestLeavesPerSecond = m_leavesPerSecond;
+                m_bestQueueSize = queueSize;
+            }
+
+            if (m_leavesPerSecond < m_lastLeavesPerSecond) {
+                m_direction = -m_direction;
+            }
+        }
+
+        m_lastLeavesPerSecond = m_leavesPerSecond;
+
+        // Steps scale with the queue size, so that large sizes are explored as quickly as small ones.
+        int step = std::max(1, queueSize / 4);
+        int nextQueueSize = std::clamp(queueSize + m_direction * step, m_minQueueSize, m_maxQueueSize);
+
+        if (nextQueueSize == queueSize) {
+            m_direction = -m_direction;  // Bounce off the bounds.
+        }
+
+        m_queueSize.store(nextQueueSize, std::memory_order_relaxed);
+
+        m_windowLeaves = 0;
+        m_windowUniqueLeaves = 0;
+        m_windowSeconds = 0.0;
+        m_windowEvalSeconds = 0.0;
+        m_windowBatchCount = 0;
+    }
+
+    /**
+     * @returns The queue size with the highest throughput seen within the collision ceiling.
+    */
+    int getBestQueueSize() const {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        return m_bestQueueSize;
+    }
+
+    /**
+     * @returns The highest throughput seen within the collision ceiling, in unique leaves per second.
+    */
+    double getBestLeavesPerSecond() const {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        return m_bestLeavesPerSecond;
+    }
+
+    /**
+     * @returns The fraction of colliding selections over the last window.
+    */
+    double getCollisionRate() const {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        return m_collisionRate;
+    }
+
+    /**
+     * @returns The average time per batch spent waiting on the network over the last window.
+    */
+    double getEvalLatency() const {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        return m_evalLatency;
+    }
+
+private:
+    int m_minQueueSize;
+    int m_maxQueueSize;
+    float m_maxCollisionRate;
+    int m_windowBatches;
+
+    std::atomic<int> m_queueSize;  // Read by every batch, so not behind the mutex.
+
+    mutable std::mutex m_mutex;
+    int m_direction { 1 };
+
+    // Measurements of the current window.
+    int m_windowBatchCount { 0 };
+    long m_windowLeaves { 0 };
+    long m_windowUniqueLeaves { 0 };
+    double m_windowSeconds { 0.0 };
+    double m_windowEvalSeconds { 0.0 };
+
+    // Results of the last window, and the best so far.
+    double m_leavesPerSecond { 0.0 };
+    double m_lastLeavesPerSecond { 0.0 };
+    double m_collisionRate { 0.0 };
+    double m_evalLatency { 0.0 };
+    double m_bestLeavesPerSecond { 0.0 };
+    int m_bestQueueSize;
+};
+
+} // namespace SPRL
+
+#endif
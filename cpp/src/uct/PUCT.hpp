@@ -0,0 +1,247 @@
+#ifndef SPRL_PUCT_HPP
+#define SPRL_PUCT_HPP
+
+/**
+ * @file PUCT.hpp
+ *
+ * Kernels for scoring the edges out of a node with the PUCT formula and
+ * picking the best one. Vectorized with AVX-512 or AVX2 when compiled for
+ * a CPU that has them (see `SPRL_NATIVE_ARCH`), with a scalar fallback.
+*/
+
+#include "../utils/AtomicFloat.hpp"
+#include "../utils/random.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+// Vector loads of statistics that other threads update atomically are benign on x86,
+// but ThreadSanitizer cannot tell, so sanitized builds take the scalar path.
+#if defined(__AVX512F__) && !defined(__SANITIZE_THREAD__)
+#define SPRL_PUCT_AVX512
+#elif defined(__AVX2__) && !defined(__SANITIZE_THREAD__)
+#define SPRL_PUCT_AVX2
+#endif
+
+#if defined(SPRL_PUCT_AVX512) || defined(SPRL_PUCT_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace SPRL {
+
+/**
+ * Per-node constants of the PUCT formula, hoisted out of the loop over edges.
+*/
+struct PUCTParams {
+    float m_uScale;      // Weight of U times the square root of the visits to the node.
+    float m_unvisitedQ;  // Q value of unvisited edges, if dropping the parent.
+};
+
+/**
+ * @tparam DROP_PARENT Whether Q is `W / N` (`InitQ::DROP_PARENT`), else `W / (1 + N)`.
+ * 
+ * @returns The PUCT score `Q + U` of a single edge.
+*/
+template <bool DROP_PARENT>
+inline float scorePUCT(float prior, float totalValue, float numVisits, const PUCTParams& params) {
+    float q;
+    if constexpr (DROP_PARENT) {
+        q = (numVisits == 0.0f) ? params.m_unvisitedQ : totalValue / numVisits;
+    } else {
+        q = totalValue / (1.0f + numVisits);
+    }
+
+    return q + params.m_uScale * prior / (1.0f + numVisits);  // Adding 1 avoids division by zero.
+}
+
+/**
+ * Scores a run of edges held in dense arrays, writing negative infinity for illegal edges.
+ *
+ * @tparam DROP_PARENT Whether Q is `W / N` (`InitQ::DROP_PARENT`), else `W / (1 + N)`.
+ *
+ * @param priors The priors of the edges.
+ * @param totalValues The total values of the edges.
+ * @param numVisits The visit counts of the edges.
+ * @param mask The mask of legal edges, nonzero if legal.
+ * @param size The number of edges.
+ * @param params The per-node constants of the formula.
+ * @param scores The output array of scores, with room for `size` floats.
+ *
+ * @note The vector paths read the statistics with plain loads. Aligned floats are
+ * never torn on x86, so concurrent updates under tree-parallel search are
+ * seen either before or after, just like with the relaxed atomic loads of the scalar path.
+*/
+template <bool DROP_PARENT>
+inline void scorePUCT(const float* priors, const float* totalValues, const float* numVisits,
+                      const float* mask, int size, const PUCTParams& params, float* scores) {
+
+    constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+
+#if defined(SPRL_PUCT_AVX512)
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 uScale = _mm512_set1_ps(params.m_uScale);
+    const __m512 unvisitedQ = _mm512_set1_ps(params.m_unvisitedQ);
+    const __m512 negInf = _mm512_set1_ps(NEG_INF);
+    const __m512 zero = _mm512_setzero_ps();
+
+    for (int i = 0; i < size; i += 16) {
+        // The tail is handled by masking, so that small action spaces still vectorize.
+        __mmask16 lanes = (size - i >= 16) ? 0xFFFF : static_cast<__mmask16>((1u << (size - i)) - 1);
+
+        __m512 p = _mm512_maskz_loadu_ps(lanes, priors + i);
+        __m512 w = _mm512_maskz_loadu_ps(lanes, totalValues + i);
+        __m512 n = _mm512_maskz_loadu_ps(lanes, numVisits + i);
+        __m512 m = _mm512_maskz_loadu_ps(lanes, mask + i);
+
+        __m512 denom = _mm512_add_ps(n, one);
+
+        __m512 q;
+        if constexpr (DROP_PARENT) {
+            __mmask16 unvisited = _mm512_cmp_ps_mask(n, zero, _CMP_EQ_OQ);
+            q = _mm512_mask_blend_ps(unvisited, _mm512_div_ps(w, n), unvisitedQ);
+        } else {
+            q = _mm512_div_ps(w, denom);
+        }
+
+        __m512 s = _mm512_add_ps(q, _mm512_div_ps(_mm512_mul_ps(uScale, p), denom));
+
+        __mmask16 legal = _mm512_cmp_ps_mask(m, zero, _CMP_NEQ_UQ);
+        _mm512_mask_storeu_ps(scores + i, lanes, _mm512_mask_blend_ps(legal, negInf, s));
+    }
+
+#elif defined(SPRL_PUCT_AVX2)
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 uScale = _mm256_set1_ps(params.m_uScale);
+    const __m256 unvisitedQ = _mm256_set1_ps(params.m_unvisitedQ);
+    const __m256 negInf = _mm256_set1_ps(NEG_INF);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i laneIdx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (int i = 0; i < size; i += 8) {
+        // The tail is handled by masking, so that small action spaces still vectorize.
+        __m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(size - i), laneIdx);
+
+        __m256 p = _mm256_maskload_ps(priors + i, lanes);
+        __m256 w = _mm256_maskload_ps(totalValues + i, lanes);
+        __m256 n = _mm256_maskload_ps(numVisits + i, lanes);
+        __m256 m = _mm256_maskload_ps(mask + i, lanes);
+
+        __m256 denom = _mm256_add_ps(n, one);
+
+        __m256 q;
+        if constexpr (DROP_PARENT) {
+            __m256 unvisited = _mm256_cmp_ps(n, zero, _CMP_EQ_OQ);
+            q = _mm256_blendv_ps(_mm256_div_ps(w, n), unvisitedQ, unvisited);
+        } else {
+            q = _mm256_div_ps(w, denom);
+        }
+
+        __m256 s = _mm256_add_ps(q, _mm256_div_ps(_mm256_mul_ps(uScale, p), denom));
+
+        __m256 legal = _mm256_cmp_ps(m, zero, _CMP_NEQ_UQ);
+        _mm256_maskstore_ps(scores + i, lanes, _mm256_blendv_ps(negInf, s, legal));
+    }
+
+#else
+    for (int i = 0; i < size; ++i) {
+        scores[i] = (mask[i] != 0.0f)
+            ? scorePUCT<DROP_PARENT>(priors[i], atomicLoad(totalValues[i]), atomicLoad(numVisits[i]), params)
+            : NEG_INF;
+    }
+#endif
+}
+
+/**
+ * @returns The maximum of the scores, at least one of which must be finite.
+*/
+inline float maxPUCT(const float* scores, int size) {
+    constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+
+#if defined(SPRL_PUCT_AVX512) || defined(SPRL_PUCT_AVX2)
+    __m256 best = _mm256_set1_ps(NEG_INF);
+
+#if defined(SPRL_PUCT_AVX512)
+    __m512 best512 = _mm512_set1_ps(NEG_INF);
+    for (int i = 0; i < size; i += 16) {
+        __mmask16 lanes = (size - i >= 16) ? 0xFFFF : static_cast<__mmask16>((1u << (size - i)) - 1);
+        best512 = _mm512_mask_max_ps(best512, lanes, best512, _mm512_maskz_loadu_ps(lanes, scores + i));
+    }
+
+    // Masked forms with explicit sources throughout, since the unmasked ones pass an undefined
+    // source that GCC reports as maybe-uninitialized.
+    const __m256d noLanes = _mm256_setzero_pd();
+    best = _mm256_max_ps(_mm256_castpd_ps(_mm512_mask_extractf64x4_pd(noLanes, 0xF, _mm512_castps_pd(best512), 0)),
+                         _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(noLanes, 0xF, _mm512_castps_pd(best512), 1)));
+#else
+    const __m256i laneIdx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (int i = 0; i < size; i += 8) {
+        __m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(size - i), laneIdx);
+        __m256 s = _mm256_blendv_ps(best, _mm256_maskload_ps(scores + i, lanes), _mm256_castsi256_ps(lanes));
+        best = _mm256_max_ps(best, s);
+    }
+#endif
+
+    // Horizontal maximum of the eight lanes.
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+    half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_max_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+
+#else
+    float best = NEG_INF;
+    for (int i = 0; i < size; ++i) {
+        best = std::max(best, scores[i]);
+    }
+
+    return best;
+#endif
+}
+
+/**
+ * Picks the index of the highest score, breaking ties uniformly at random.
+ *
+ * Finds the maximum in one pass and counts the ties in another, so only
+ * draws a random number (and never allocates) when there actually is a tie.
+ *
+ * @param scores The scores, at least one of which must be finite.
+ * @param size The number of scores.
+ *
+ * @returns The index of the chosen score.
+*/
+inline int pickBestPUCT(const float* scores, int size) {
+    assert(size > 0);
+
+    const float best = maxPUCT(scores, size);
+
+    int numTies = 0;
+    int firstTie = -1;
+    for (int i = 0; i < size; ++i) {
+        if (scores[i] == best) {
+            firstTie = (numTies == 0) ? i : firstTie;
+            ++numTies;
+        }
+    }
+
+    assert(numTies > 0);
+
+    if (numTies == 1) {
+        return firstTie;
+    }
+
+    int pick = GetRandom().UniformInt(0, numTies - 1);
+    for (int i = firstTie; i < size; ++i) {
+        if (scores[i] == best && pick-- == 0) {
+            return i;
+        }
+    }
+
+    assert(false);
+    return firstTie;
+}
+
+} // namespace SPRL
+
+#endif
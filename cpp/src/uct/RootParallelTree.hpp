@@ -0,0 +1,353 @@
+#ifndef SPRL_ROOT_PARALLEL_TREE_HPP
+#define SPRL_ROOT_PARALLEL_TREE_HPP
+
+#include "../games/GameNode.hpp"
+#include "../networks/INetwork.hpp"
+#include "../symmetry/ISymmetrizer.hpp"
+
+#include "BatchSizeTuner.hpp"
+#include "UCTTree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SPRL {
+
+/**
+ * Several independent UCT trees searching the same decision node, each on its own thread,
+ * with their root visit counts summed to choose moves and make policy targets.
+ *
+ * Unlike tree-parallel search, the threads share no nodes, so never wait on each other's
+ * locks or steer each other with virtual losses. Each search thread draws from its own
+ * random stream, so every tree gets its own Dirichlet noise at the decision node.
+ *
+ * With a single tree, searches run on the calling thread, exactly as with a `UCTTree`.
+ *
+ * @tparam ImplNode The implementation of the game node.
+ * @tparam State The state of the game.
+ * @tparam ACTION_SIZE The number of actions in the game.
+ * @tparam INIT_Q The method for initializing Q values, see `UCTNode`.
+*/
+template <typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q = InitQ::PARENT>
+class RootParallelTree {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+    using Tree = UCTTree<ImplNode, State, ACTION_SIZE, INIT_Q>;
+    using UNode = typename Tree::UNode;
+
+    /**
+     * Constructs one UCT tree per given game root. See `UCTTree` for the other parameters.
+     *
+     * @param gameRoots The root nodes of the game trees, all of the same position.
+     * @param maxNodesPerTree The most UCT nodes to keep in each tree, or zero for no limit.
+     * @param solver Whether the trees prove nodes and steer search by the proofs.
+    */
+    RootParallelTree(std::vector<std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>>> gameRoots,
+                     float dirEps, float dirAlpha,
+                     ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true,
+                     Transpositions transpositions = Transpositions::NONE, size_t maxNodesPerTree = 0,
+                     bool solver = false)
+        : m_solver { solver } {
+
+        assert(!gameRoots.empty());
+
+        m_trees.reserve(gameRoots.size());
+        for (auto& gameRoot : gameRoots) {
+            m_trees.push_back(std::make_unique<Tree>(
+                std::move(gameRoot), dirEps, dirAlpha, symmetrizer,
+                addNoise, false, transpositions, maxNodesPerTree, solver));
+        }
+    }
+
+    /**
+     * @returns A readonly pointer to the decision node of the first tree,
+     * which holds the same position as those of the others.
+    */
+    const UNode* getDecisionNode() {
+        return m_trees[0]->getDecisionNode();
+    }
+
+    /**
+     * @returns The number of trees.
+    */
+    int getNumTrees() const {
+        return static_cast<int>(m_trees.size());
+    }
+
+    /**
+     * @returns The root visit counts of the decision node, summed over all the trees.
+     *
+     * With the solver on, the counts play by the proofs that any of the trees found: if some
+     * moves are proven wins, only they keep their visits (at least one each), and otherwise
+     * moves proven lost lose theirs, unless every move is. So a proven loss is never sampled
+     * nor taught as a policy target while something better is known or still open.
+    */
+    ActionDist getRootVisits() {
+        ActionDist visits = m_trees[0]->getDecisionNode()->getEdgeStatistics().m_numVisits;
+
+        for (int k = 1; k < getNumTrees(); ++k) {
+            visits = visits + m_trees[k]->getDecisionNode()->getEdgeStatistics().m_numVisits;
+        }
+
+        if (!m_solver) {
+            return visits;
+        }
+
+        // Proofs are exact, so one found by any tree holds for all of them.
+        std::array<Proof, ACTION_SIZE> proofs = m_trees[0]->getDecisionNode()->getChildProofs();
+
+        for (int k = 1; k < getNumTrees(); ++k) {
+            std::array<Proof, ACTION_SIZE> treeProofs = m_trees[k]->getDecisionNode()->getChildProofs();
+
+            for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
+                proofs[action] = (proofs[action] == Proof::UNKNOWN) ? treeProofs[action] : proofs[action];
+            }
+        }
+
+        return playByProofs(visits, proofs, getDecisionNode()->getActionMask());
+    }
+
+    /**
+     * Sets whether to add Dirichlet noise to the decision nodes, from the next search on.
+    */
+    void setAddNoise(bool addNoise) {
+        for (auto& tree : m_trees) {
+            tree->setAddNoise(addNoise);
+        }
+    }
+
+    /**
+     * Sets the tuner to size the batches of every tree with. See `UCTTree::setBatchSizeTuner`.
+    */
+    void setBatchSizeTuner(BatchSizeTuner* tuner) {
+        for (auto& tree : m_trees) {
+            tree->setBatchSizeTuner(tuner);
+        }
+    }
+
+    /**
+     * Sets whether every tree fills short batches speculatively. See `UCTTree::setSpeculativeFill`.
+    */
+    void setSpeculativeFill(bool speculativeFill) {
+        for (auto& tree : m_trees) {
+            tree->setSpeculativeFill(speculativeFill);
+        }
+    }
+
+    /**
+     * Sets the pruning width of every tree. See `UCTTree::setPruneWidth`.
+    */
+    void setPruneWidth(int pruneWidth) {
+        for (auto& tree : m_trees) {
+            tree->setPruneWidth(pruneWidth);
+        }
+    }
+
+    /**
+     * Searches every tree concurrently, splitting the traversals evenly between them.
+     * See `UCTTree::search` for the parameters; `numThreads` threads search each tree,
+     * and stopping early is decided by each tree on its own.
+     *
+     * If the network is not thread-safe, the trees take turns evaluating,
+     * but still select leaves while another tree's batch is evaluated.
+     *
+     * @returns The number of traversals performed, summed over all the trees.
+    */
+    int search(int numTraversals, int maxBatchSize, int maxQueueSize,
+               INetwork<State, ACTION_SIZE>* network, float uWeight = 1.0f, int numThreads = 1,
+               bool pipelined = false, bool stopEarly = false) {
+
+        return searchEach(numTraversals, network, [&](Tree& tree, int treeTraversals, INetwork<State, ACTION_SIZE>* treeNetwork) {
+            return tree.search(treeTraversals, maxBatchSize, maxQueueSize,
+                               treeNetwork, uWeight, numThreads, pipelined, stopEarly);
+        });
+    }
+
+    /**
+     * Runs a Gumbel search on every tree concurrently, splitting the traversals evenly
+     * between them, like `search`. See `UCTTree::searchGumbel` for the parameters.
+     *
+     * @returns The number of traversals performed, summed over all the trees.
+    */
+    int searchGumbel(int numTraversals, int numSampledActions, int maxBatchSize, int maxQueueSize,
+                     INetwork<State, ACTION_SIZE>* network, float uWeight = 1.0f, int numThreads = 1,
+                     bool pipelined = false) {
+
+        return searchEach(numTraversals, network, [&](Tree& tree, int treeTraversals, INetwork<State, ACTION_SIZE>* treeNetwork) {
+            return tree.searchGumbel(treeTraversals, numSampledActions, maxBatchSize, maxQueueSize,
+                                     treeNetwork, uWeight, numThreads, pipelined);
+        });
+    }
+
+    /**
+     * @returns The action picked by the last Gumbel search of the first tree. The other
+     * trees, with their own samples, only contribute to the policy target.
+    */
+    ActionIdx getGumbelAction() const {
+        return m_trees[0]->getGumbelAction();
+    }
+
+    /**
+     * @returns The improved policy of Gumbel search, averaged over all the trees.
+     * See `UCTTree::getImprovedPolicy`.
+    */
+    ActionDist getImprovedPolicy() {
+        ActionDist policy = m_trees[0]->getImprovedPolicy();
+
+        for (int k = 1; k < getNumTrees(); ++k) {
+            policy = policy + m_trees[k]->getImprovedPolicy();
+        }
+
+        return policy / static_cast<float>(getNumTrees());
+    }
+
+    /**
+     * Advances the decision node of every tree. See `UCTTree::advanceDecision`.
+    */
+    void advanceDecision(ActionIdx action) {
+        for (auto& tree : m_trees) {
+            tree->advanceDecision(action);
+        }
+    }
+
+private:
+    /**
+     * Steers visit counts by the proofs of the moves, as described in `getRootVisits`.
+     *
+     * @param visits The visit counts of the moves.
+     * @param proofs The proofs of the moves, from the perspective of the player to move.
+     * @param actionMask The mask of legal moves.
+     *
+     * @returns The steered visit counts.
+    */
+    static ActionDist playByProofs(const ActionDist& visits, const std::array<Proof, ACTION_SIZE>& proofs,
+                                   const ActionDist& actionMask) {
+
+        ActionDist wins {};
+        ActionDist notLost {};
+        bool anyWin = false;
+        bool anyNotLost = false;
+
+        for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
+            if (actionMask[action] == 0.0f) {
+                continue;
+            }
+
+            if (proofs[action] == Proof::WIN) {
+                wins[action] = std::max(visits[action], 1.0f);
+                anyWin = true;
+            }
+
+            if (proofs[action] != Proof::LOSS) {
+                notLost[action] = visits[action];
+                anyNotLost = true;
+            }
+        }
+
+        if (anyWin) {
+            return wins;
+        }
+
+        if (!anyNotLost) {
+            return visits;  // Lost whatever the move: play as searched.
+        }
+
+        if (notLost.sum() == 0.0f) {
+            // Every visited move is proven lost: spread over the rest instead.
+            for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
+                notLost[action] = (actionMask[action] != 0.0f && proofs[action] != Proof::LOSS) ? 1.0f : 0.0f;
+            }
+        }
+
+        return notLost;
+    }
+
+    /**
+     * Runs a search on every tree, on a thread each unless there is only one tree.
+     *
+     * @param numTraversals The traversals to split evenly between the trees.
+     * @param network The network to evaluate with, serialized if it is not thread-safe.
+     * @param searchTree Searches a tree for a number of traversals with a network,
+     * returning the number of traversals performed.
+     *
+     * @returns The number of traversals performed, summed over all the trees.
+    */
+    template <typename SearchTree>
+    int searchEach(int numTraversals, INetwork<State, ACTION_SIZE>* network, SearchTree searchTree) {
+        int numTrees = getNumTrees();
+
+        if (numTrees == 1) {
+            return searchTree(*m_trees[0], numTraversals, network);
+        }
+
+        SerializedNetwork serializedNetwork { network };
+        INetwork<State, ACTION_SIZE>* sharedNetwork = network->isThreadSafe() ? network : &serializedNetwork;
+
+        std::vector<int> traversals (numTrees, 0);
+        std::vector<std::thread> threads;
+        threads.reserve(numTrees);
+
+        for (int k = 0; k < numTrees; ++k) {
+            // Hand out the remainder one by one, so the budget is met exactly.
+            int treeTraversals = numTraversals / numTrees + (k < numTraversals % numTrees ? 1 : 0);
+
+            threads.emplace_back([&, k, treeTraversals]() {
+                traversals[k] = searchTree(*m_trees[k], treeTraversals, sharedNetwork);
+            });
+        }
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        int totalTraversals = 0;
+        for (int trav : traversals) {
+            totalTraversals += trav;
+        }
+
+        return totalTraversals;
+    }
+
+    /**
+     * Makes a network safe to share between the trees by evaluating one batch at a time.
+    */
+    class SerializedNetwork : public INetwork<State, ACTION_SIZE> {
+    public:
+        explicit SerializedNetwork(INetwork<State, ACTION_SIZE>* network)
+            : m_network { network } {
+        }
+
+        std::vector<std::pair<ActionDist, Value>> evaluate(
+            const std::vector<State>& states,
+            const std::vector<ActionDist>& masks) override {
+
+            std::lock_guard<std::mutex> lock { m_mutex };
+            return m_network->evaluate(states, masks);
+        }
+
+        int getNumEvals() override {
+            std::lock_guard<std::mutex> lock { m_mutex };
+            return m_network->getNumEvals();
+        }
+
+        bool isThreadSafe() const override {
+            return true;
+        }
+
+    private:
+        INetwork<State, ACTION_SIZE>* m_network;
+        std::mutex m_mutex;
+    };
+
+    std::vector<std::unique_ptr<Tree>> m_trees;
+    bool m_solver;  // Whether the trees prove nodes, so that moves are played by the proofs.
+};
+
+} // namespace SPRL
+
+#endif
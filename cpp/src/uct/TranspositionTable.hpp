@@ -0,0 +1,187 @@
+#ifndef SPRL_TRANSPOSITION_TABLE_HPP
+#define SPRL_TRANSPOSITION_TABLE_HPP
+
+#include "../games/GameNode.hpp"
+
+#include "../utils/SpinLock.hpp"
+#include "../utils/Zobrist.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+
+namespace SPRL {
+
+/**
+ * How a `UCTTree` exploits positions reached by different move orders.
+*/
+enum class Transpositions {
+    NONE,         // Pure tree search, every node is evaluated separately.
+    EVALUATIONS,  // Reuse network outputs across transposed positions.
+    STATISTICS    // Also share value statistics across them, as in DAG-style MCTS.
+};
+
+/**
+ * Fixed-size hash table from position hashes (see `GameNode::getHash`)
+ * to network outputs and aggregate value statistics of the position.
+ *
+ * Direct-mapped, with a newer position always replacing an older one in its slot,
+ * so memory stays bounded however long the game. Each slot has its own spin lock,
+ * so concurrent search threads only contend when they touch the same slot.
+ *
+ * @tparam ACTION_SIZE The size of the action space.
+*/
+template <int ACTION_SIZE>
+class TranspositionTable {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+
+    /**
+     * Constructs an empty table.
+     *
+     * @param log2NumSlots The base-2 logarithm of the number of slots.
+    */
+    explicit TranspositionTable(int log2NumSlots = 16)
+        : m_mask { (ZobristHash { 1 } << log2NumSlots) - 1 },
+          m_slots { std::make_unique<Slot[]>(m_mask + 1) } {
+    }
+
+    /**
+     * Looks up the network output for a position.
+     *
+     * @param hash The hash of the position.
+     * @param policy Set to the cached policy, if found.
+     * @param value Set to the cached value, if found.
+     *
+     * @returns Whether the position was found.
+    */
+    bool lookup(ZobristHash hash, ActionDist& policy, Value& value) {
+        Slot& slot = getSlot(hash);
+        std::lock_guard<SpinLock> guard { slot.m_lock };
+
+        m_numLookups.fetch_add(1, std::memory_order_relaxed);
+
+        if (!slot.m_occupied || slot.m_key != hash) {
+            return false;
+        }
+
+        m_numHits.fetch_add(1, std::memory_order_relaxed);
+
+        policy = slot.m_policy;
+        value = slot.m_value;
+        return true;
+    }
+
+    /**
+     * Stores the network output for a position, evicting whatever was in its slot.
+    */
+    void store(ZobristHash hash, const ActionDist& policy, Value value) {
+        Slot& slot = getSlot(hash);
+        std::lock_guard<SpinLock> guard { slot.m_lock };
+
+        if (!slot.m_occupied || slot.m_key != hash) {
+            slot.m_occupied = true;
+            slot.m_key = hash;
+            slot.m_totalValue = 0.0f;
+            slot.m_numVisits = 0.0f;
+        }
+
+        slot.m_policy = policy;
+        slot.m_value = value;
+    }
+
+    /**
+     * Adds a visit with the given value to the statistics of a position, if it is in the table.
+     *
+     * @param value The value of the visit, from the perspective of the player to move.
+    */
+    void addVisit(ZobristHash hash, Value value) {
+        addVisits(hash, 1.0f, value);
+    }
+
+    /**
+     * Adds several visits at once to the statistics of a position, if it is in the table.
+     *
+     * @param numVisits The number of visits.
+     * @param totalValue The total value of the visits, from the perspective of the player to move.
+    */
+    void addVisits(ZobristHash hash, float numVisits, Value totalValue) {
+        Slot& slot = getSlot(hash);
+        std::lock_guard<SpinLock> guard { slot.m_lock };
+
+        if (slot.m_occupied && slot.m_key == hash) {
+            slot.m_totalValue += totalValue;
+            slot.m_numVisits += numVisits;
+        }
+    }
+
+    /**
+     * Reads the aggregate statistics of a position.
+     *
+     * @param totalValue Set to the total value of all visits, from the perspective of the player to move.
+     * @param numVisits Set to the number of visits, or zero if the position is not in the table.
+    */
+    void getStatistics(ZobristHash hash, float& totalValue, float& numVisits) {
+        Slot& slot = getSlot(hash);
+        std::lock_guard<SpinLock> guard { slot.m_lock };
+
+        bool found = slot.m_occupied && slot.m_key == hash;
+
+        totalValue = found ? slot.m_totalValue : 0.0f;
+        numVisits = found ? slot.m_numVisits : 0.0f;
+    }
+
+    /**
+     * Resets the statistics of every position, keeping the network outputs.
+     *
+     * @note Not safe to call concurrently with other operations.
+    */
+    void clearStatistics() {
+        for (ZobristHash i = 0; i <= m_mask; ++i) {
+            m_slots[i].m_totalValue = 0.0f;
+            m_slots[i].m_numVisits = 0.0f;
+        }
+    }
+
+    /**
+     * @returns The number of lookups of network outputs so far.
+    */
+    int getNumLookups() const {
+        return m_numLookups.load();
+    }
+
+    /**
+     * @returns The number of lookups that found a network output.
+    */
+    int getNumHits() const {
+        return m_numHits.load();
+    }
+
+private:
+    struct Slot {
+        SpinLock m_lock {};
+        bool m_occupied { false };
+        ZobristHash m_key { 0 };
+
+        ActionDist m_policy {};  // Cached network policy output.
+        Value m_value {};        // Cached network value output.
+
+        float m_totalValue { 0.0f };  // Total value of visits, for the player to move.
+        float m_numVisits { 0.0f };   // Number of visits across all transpositions.
+    };
+
+    Slot& getSlot(ZobristHash hash) {
+        return m_slots[hash & m_mask];
+    }
+
+    ZobristHash m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+
+    std::atomic<int> m_numLookups { 0 };
+    std::atomic<int> m_numHits { 0 };
+};
+
+} // namespace SPRL
+
+#endif
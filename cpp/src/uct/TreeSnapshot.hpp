@@ -0,0 +1,299 @@
+#ifndef SPRL_TREE_SNAPSHOT_HPP
+#define SPRL_TREE_SNAPSHOT_HPP
+
+/**
+ * @file TreeSnapshot.hpp
+ *
+ * A file format for saving the search below a node of a `UCTTree`,
+ * to be memory-mapped back later as a warm start.
+ *
+ * Only what search learned is saved: the network outputs, edge statistics
+ * and proofs of each node, but not its game node, which is rebuilt by
+ * replaying actions when the node is reached again. Nodes refer to each
+ * other by index rather than by pointer, so the file can be mapped at any
+ * address and read in place, without parsing.
+ *
+ * The layout is a header, followed by the actions leading from the root of the
+ * game to the saved node, then one record per node in breadth-first order
+ * (the saved node first), then the edge records of all the nodes, contiguous
+ * per node and in the edge order of the node layout. Values are stored in
+ * native byte order, so files are not portable between architectures.
+*/
+
+#include "../games/GameNode.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SPRL {
+
+/**
+ * The header at the start of a snapshot file.
+*/
+struct SnapshotHeader {
+    char m_magic[8];           // Always `SNAPSHOT_MAGIC`.
+    uint32_t m_version;        // Always `SNAPSHOT_VERSION`.
+    uint32_t m_actionSize;     // The size of the action space of the game.
+    uint32_t m_sparseEdges;    // Whether nodes have an edge per legal action, rather than per action.
+    uint32_t m_pathLength;     // The number of actions from the root of the game to the saved node.
+    uint32_t m_numNodes;       // The number of node records.
+    uint32_t m_numEdges;       // The number of edge records.
+    float m_rootNumVisits;     // Visits to the saved node.
+    float m_rootTotalValue;    // Total value of the saved node, from the perspective of its parent.
+    uint64_t m_pathOffset;     // Byte offset of the actions to the saved node.
+    uint64_t m_nodesOffset;    // Byte offset of the node records.
+    uint64_t m_edgesOffset;    // Byte offset of the edge records.
+};
+
+/**
+ * The record of a single node in a snapshot.
+*/
+struct SnapshotNode {
+    uint32_t m_firstEdge;         // Index of the first edge record of the node.
+    uint32_t m_numEdges;          // Number of edge records of the node, zero if never evaluated.
+    float m_networkValue;         // Cached network value output.
+    uint8_t m_isNetworkEvaluated; // Whether the node has been evaluated by the network.
+    uint8_t m_isExpanded;         // Whether the edge statistics were in use, rather than stale.
+    uint8_t m_proof;              // The `Proof` of the node.
+    uint8_t m_padding;
+};
+
+/**
+ * The record of a single edge in a snapshot.
+*/
+struct SnapshotEdge {
+    int32_t m_child;       // Index of the node record of the child, -1 if it was never created.
+    float m_policy;        // Cached network policy output, without noise.
+    float m_prior;         // Prior used to compute U, i.e. the policy, possibly with noise.
+    float m_totalValue;    // Total Q value accumulated on the edge.
+    float m_numVisits;     // Number of times the edge has been traversed.
+};
+
+static_assert(sizeof(SnapshotHeader) == 64);
+static_assert(sizeof(SnapshotNode) == 16);
+static_assert(sizeof(SnapshotEdge) == 20);
+
+constexpr char SNAPSHOT_MAGIC[8] = { 'S', 'P', 'R', 'L', 'T', 'R', 'E', 'E' };
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+/**
+ * A snapshot file, memory-mapped read-only. Pages are only read in from
+ * disk as the records on them are used, so opening even a large snapshot
+ * costs next to nothing. The header and the saved node are checked on open,
+ * every other record when it is first reached, so that a truncated or
+ * damaged file never leads to reads outside the mapping.
+*/
+class TreeSnapshot {
+public:
+    /**
+     * Maps a snapshot file and checks that it fits the game.
+     *
+     * @param path The path of the file.
+     * @param actionSize The size of the action space of the game.
+     * @param sparseEdges Whether the nodes of the game use the sparse edge layout.
+     *
+     * @returns The snapshot, or nullptr if the file is missing, malformed, or for another game.
+    */
+    static std::unique_ptr<TreeSnapshot> open(const std::string& path, int actionSize, bool sparseEdges) {
+        std::unique_ptr<TreeSnapshot> snapshot { new TreeSnapshot() };
+
+        if (!snapshot->map(path) || !snapshot->isValid(actionSize, sparseEdges) || !snapshot->isNodeValid(0)) {
+            return nullptr;
+        }
+
+        return snapshot;
+    }
+
+    /**
+     * Writes a snapshot file, replacing any file at the path.
+     *
+     * @param path The path of the file.
+     * @param header The header, whose magic, version, counts and offsets are filled in here.
+     * @param actions The actions from the root of the game to the saved node.
+     * @param nodes The node records, the saved node first.
+     * @param edges The edge records.
+     *
+     * @returns Whether the file was written.
+    */
+    static bool write(const std::string& path, SnapshotHeader header, const std::vector<ActionIdx>& actions,
+                      const std::vector<SnapshotNode>& nodes, const std::vector<SnapshotEdge>& edges) {
+
+        std::memcpy(header.m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.m_version = SNAPSHOT_VERSION;
+        header.m_pathLength = actions.size();
+        header.m_numNodes = nodes.size();
+        header.m_numEdges = edges.size();
+
+        // Every section starts on an 8-byte boundary, so records can be read in place.
+        header.m_pathOffset = sizeof(SnapshotHeader);
+        header.m_nodesOffset = alignUp(header.m_pathOffset + actions.size() * sizeof(ActionIdx));
+        header.m_edgesOffset = alignUp(header.m_nodesOffset + nodes.size() * sizeof(SnapshotNode));
+
+        std::ofstream file { path, std::ios::binary | std::ios::trunc };
+
+        auto writeAt = [&](uint64_t offset, const void* data, size_t bytes) {
+            file.seekp(offset);
+            file.write(static_cast<const char*>(data), bytes);
+        };
+
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.m_pathOffset, actions.data(), actions.size() * sizeof(ActionIdx));
+        writeAt(header.m_nodesOffset, nodes.data(), nodes.size() * sizeof(SnapshotNode));
+        writeAt(header.m_edgesOffset, edges.data(), edges.size() * sizeof(SnapshotEdge));
+
+        file.close();
+        return file.good();
+    }
+
+    TreeSnapshot(const TreeSnapshot&) = delete;
+    TreeSnapshot& operator=(const TreeSnapshot&) = delete;
+
+    ~TreeSnapshot() {
+#ifdef __linux__
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+#endif
+    }
+
+    const SnapshotHeader& header() const {
+        return *reinterpret_cast<const SnapshotHeader*>(m_data);
+    }
+
+    /**
+     * @returns The action at the given step of the path from the root of the game to the saved node.
+    */
+    ActionIdx pathAction(int step) const {
+        return reinterpret_cast<const ActionIdx*>(m_data + header().m_pathOffset)[step];
+    }
+
+    const SnapshotNode& node(int nodeIdx) const {
+        return reinterpret_cast<const SnapshotNode*>(m_data + header().m_nodesOffset)[nodeIdx];
+    }
+
+    const SnapshotEdge& edge(int nodeIdx, int edgeIdx) const {
+        return reinterpret_cast<const SnapshotEdge*>(m_data + header().m_edgesOffset)[node(nodeIdx).m_firstEdge + edgeIdx];
+    }
+
+    /**
+     * @returns The index of the node record of the child along an edge, or -1 if there is none
+     * or its record is out of bounds.
+    */
+    int child(int nodeIdx, int edgeIdx) const {
+        if (edgeIdx >= static_cast<int>(node(nodeIdx).m_numEdges)) {
+            return -1;
+        }
+
+        int childIdx = edge(nodeIdx, edgeIdx).m_child;
+        return isNodeValid(childIdx) ? childIdx : -1;
+    }
+
+    /**
+     * @returns The search epoch of the tree when the snapshot was loaded into it.
+    */
+    uint32_t getEpoch() const {
+        return m_epoch;
+    }
+
+    void setEpoch(uint32_t epoch) {
+        m_epoch = epoch;
+    }
+
+private:
+    TreeSnapshot() = default;
+
+    static uint64_t alignUp(uint64_t offset) {
+        return (offset + 7) / 8 * 8;
+    }
+
+    /**
+     * Maps the whole file read-only.
+     *
+     * @returns Whether the file was mapped.
+    */
+    bool map(const std::string& path) {
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+            ::close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // The mapping keeps the file open.
+
+        if (data == MAP_FAILED) {
+            return false;
+        }
+
+        m_data = static_cast<char*>(data);
+        m_size = status.st_size;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @returns Whether the mapped file is a snapshot of the given game, with every section in bounds.
+    */
+    bool isValid(int actionSize, bool sparseEdges) const {
+        const SnapshotHeader& head = header();
+
+        if (std::memcmp(head.m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+            || head.m_version != SNAPSHOT_VERSION
+            || head.m_actionSize != static_cast<uint32_t>(actionSize)
+            || head.m_sparseEdges != static_cast<uint32_t>(sparseEdges)
+            || head.m_numNodes == 0) {
+
+            return false;
+        }
+
+        return head.m_pathOffset + head.m_pathLength * sizeof(ActionIdx) <= m_size
+            && head.m_nodesOffset + head.m_numNodes * sizeof(SnapshotNode) <= m_size
+            && head.m_edgesOffset + head.m_numEdges * sizeof(SnapshotEdge) <= m_size;
+    }
+
+    /**
+     * Checks a node record and the extent of its edge records. Records are checked as they are
+     * reached through `child`, rather than all on open, so that opening stays cheap.
+     *
+     * @returns Whether the record is in bounds and all of its edge records are too.
+    */
+    bool isNodeValid(int nodeIdx) const {
+        const SnapshotHeader& head = header();
+
+        if (nodeIdx < 0 || static_cast<uint32_t>(nodeIdx) >= head.m_numNodes) {
+            return false;
+        }
+
+        const SnapshotNode& record = node(nodeIdx);
+        return record.m_numEdges <= head.m_actionSize
+            && static_cast<uint64_t>(record.m_firstEdge) + record.m_numEdges <= head.m_numEdges;
+    }
+
+    char* m_data { nullptr };  // Start of the mapping.
+    size_t m_size { 0 };       // Bytes mapped, i.e. the file size.
+
+    uint32_t m_epoch { 0 };
+};
+
+} // namespace SPRL
+
+#endif
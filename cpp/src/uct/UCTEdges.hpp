@@ -0,0 +1,462 @@
+#ifndef SPRL_UCT_EDGES_HPP
+#define SPRL_UCT_EDGES_HPP
+
+/**
+ * @file UCTEdges.hpp
+ *
+ * Storage layouts for the edges coming out of a `UCTNode`.
+ *
+ * Both layouts expose the same interface in terms of an *edge index*,
+ * so that the node can be written once against either of them:
+ * under the dense layout the edge index is the action itself,
+ * while under the sparse layout it indexes the legal actions only.
+*/
+
+#include "../games/GameActionDist.hpp"
+#include "../games/GameNode.hpp"
+
+#include "../utils/AtomicFloat.hpp"
+#include "../utils/NodePool.hpp"
+
+#include "PUCT.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace SPRL {
+
+// Forward declarations of the games that prefer the sparse layout.
+class GoNode;
+class OthelloNode;
+
+/**
+ * Holds statistics for the edges coming out of a node in the UCT tree,
+ * as one dense array per statistic, indexed by action.
+*/
+template <int ACTION_SIZE>
+struct UCTEdgeStatistics {
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+
+    ActionDist m_childPriors {};  // Prior from network, used to compute U.
+    ActionDist m_totalValues {};  // Total Q value accumulated on each edge.
+    ActionDist m_numVisits {};    // Number of times each edge has been traversed.
+
+    UCTEdgeStatistics() {
+        reset();
+    }
+
+    void reset() {
+        m_childPriors.fill(0.0);
+        m_totalValues.fill(0.0);
+        m_numVisits.fill(0.0);
+    }
+};
+
+/**
+ * Dense edge layout: every statistic is an `ACTION_SIZE`-long array indexed by action,
+ * plus an array of children. Indexing is trivial, but every node pays for the whole
+ * action space, however few of its actions are legal.
+ *
+ * @tparam Node The node type at the ends of the edges.
+ * @tparam ACTION_SIZE The size of the action space.
+*/
+template <typename Node, int ACTION_SIZE>
+class DenseUCTEdges {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+    using Statistics = UCTEdgeStatistics<ACTION_SIZE>;
+
+    /// Whether the edges are also ranked by policy, for pruned selection. Not worth it on small action spaces.
+    static constexpr bool RANKS_BY_POLICY = false;
+
+    /**
+     * Handle to a single edge, held by the child at its end.
+    */
+    struct Ref {
+        Statistics* m_stats;
+        ActionIdx m_action;
+
+        float& numVisits() const { return m_stats->m_numVisits[m_action]; }
+        float& totalValue() const { return m_stats->m_totalValues[m_action]; }
+    };
+
+    /**
+     * Stand-in for the edge into the root, held by the tree.
+    */
+    struct RootEdge {
+        Statistics m_stats {};
+
+        Ref ref() { return { &m_stats, 0 }; }
+    };
+
+    /**
+     * Stand-in for the pool of edge storage, held by the tree.
+     * Holds nothing, since dense edges live inside the node.
+    */
+    struct Pool {
+        explicit Pool(bool) {}
+
+        size_t bytesInUse() const { return 0; }
+    };
+
+    void setPool(Pool*) {}
+    Pool* getPool() const { return nullptr; }
+
+    /**
+     * Prepares storage for the legal actions; a no-op, since everything is preallocated.
+    */
+    void allocate(const ActionDist&) {}
+
+    /**
+     * @returns The number of edge indices, legal or not.
+    */
+    int size() const { return ACTION_SIZE; }
+
+    ActionIdx action(int edgeIdx) const { return static_cast<ActionIdx>(edgeIdx); }
+    int find(ActionIdx action) const { return action; }
+    bool isLegal(int edgeIdx, const ActionDist& actionMask) const { return actionMask[edgeIdx] != 0.0f; }
+
+    float& numVisits(int edgeIdx) { return m_stats.m_numVisits[edgeIdx]; }
+    float& totalValue(int edgeIdx) { return m_stats.m_totalValues[edgeIdx]; }
+    float& prior(int edgeIdx) { return m_stats.m_childPriors[edgeIdx]; }
+    float& policy(int edgeIdx) { return m_networkPolicy[edgeIdx]; }
+
+    const float& numVisits(int edgeIdx) const { return m_stats.m_numVisits[edgeIdx]; }
+    const float& totalValue(int edgeIdx) const { return m_stats.m_totalValues[edgeIdx]; }
+    const float& prior(int edgeIdx) const { return m_stats.m_childPriors[edgeIdx]; }
+    const float& policy(int edgeIdx) const { return m_networkPolicy[edgeIdx]; }
+
+    PoolPtr<Node>& child(int edgeIdx) { return m_children[edgeIdx]; }
+    const PoolPtr<Node>& child(int edgeIdx) const { return m_children[edgeIdx]; }
+
+    Ref ref(int edgeIdx) { return { &m_stats, static_cast<ActionIdx>(edgeIdx) }; }
+
+    /**
+     * Writes the PUCT score of every edge into `scores`, vectorized over the dense arrays.
+     * See `scorePUCT` for `DROP_PARENT`.
+    */
+    template <bool DROP_PARENT>
+    void score(const PUCTParams& params, const ActionDist& actionMask, float* scores) const {
+        scorePUCT<DROP_PARENT>(&m_stats.m_childPriors[0], &m_stats.m_totalValues[0], &m_stats.m_numVisits[0],
+                  &actionMask[0], ACTION_SIZE, params, scores);
+    }
+
+    /**
+     * Caches the network policy.
+    */
+    void setPolicy(const ActionDist& networkPolicy, const ActionDist&) {
+        m_networkPolicy = networkPolicy;
+    }
+
+    /**
+     * Resets the priors and traversal statistics, keeping the cached policy and children.
+    */
+    void reset() {
+        m_stats.reset();
+    }
+
+    /**
+     * @returns A copy of the statistics, indexed by action.
+    */
+    Statistics snapshot() const {
+        return m_stats;
+    }
+
+    /**
+     * @returns The number of bytes held outside of the node itself.
+    */
+    size_t heapBytes() const {
+        return 0;
+    }
+
+private:
+    Statistics m_stats {};                                 // Edge stats out of this node.
+    ActionDist m_networkPolicy {};                         // Cached network policy output.
+    std::array<PoolPtr<Node>, ACTION_SIZE> m_children {};  // Parent owns children.
+};
+
+/**
+ * Sparse edge layout: one contiguous array of records, one per legal action,
+ * holding everything about the edge side by side. Allocated the first time
+ * the node is evaluated or has a child added, and sized to the number of legal actions,
+ * from the pool of the tree (see `ArrayPool`) if the node is in one.
+ *
+ * To keep records at 24 bytes, the cached network policy shares its slot with the prior.
+ * This is safe since the two only differ once Dirichlet noise is mixed in, which
+ * happens at the decision node, and nodes at or above the decision node are
+ * never cleared and re-expanded.
+ *
+ * The edges also keep a ranking by policy, in what would otherwise be padding,
+ * so that selection can look at only the most likely few of them.
+ *
+ * @tparam Node The node type at the ends of the edges.
+ * @tparam ACTION_SIZE The size of the action space.
+*/
+template <typename Node, int ACTION_SIZE>
+class SparseUCTEdges {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+    using Statistics = UCTEdgeStatistics<ACTION_SIZE>;
+
+    /// Whether the edges are also ranked by policy, for pruned selection.
+    static constexpr bool RANKS_BY_POLICY = true;
+
+    /**
+     * All the data on a single edge, packed into one record.
+    */
+    struct Edge {
+        PoolPtr<Node> m_child {};  // Parent owns children.
+        float m_prior {};          // Prior from network (doubling as the cached policy), used to compute U.
+        float m_totalValue {};     // Total Q value accumulated on the edge.
+        float m_numVisits {};      // Number of times the edge has been traversed.
+        ActionIdx m_action {};     // Action taken along the edge.
+        int16_t m_rankedEdge {};   // Edge index of the edge with this edge's index as its rank by policy.
+    };
+
+    static_assert(sizeof(Edge) == 24);
+
+    /// Pool of edge records, held by the tree so that expansion does not go through `malloc`.
+    using Pool = ArrayPool<Edge, ACTION_SIZE>;
+
+    /**
+     * Handle to a single edge, held by the child at its end.
+    */
+    struct Ref {
+        Edge* m_edge;
+
+        float& numVisits() const { return m_edge->m_numVisits; }
+        float& totalValue() const { return m_edge->m_totalValue; }
+    };
+
+    /**
+     * Stand-in for the edge into the root, held by the tree.
+    */
+    struct RootEdge {
+        Edge m_edge {};
+
+        Ref ref() { return { &m_edge }; }
+    };
+
+    SparseUCTEdges() = default;
+
+    ~SparseUCTEdges() {
+        if (m_edges == nullptr) {
+            return;
+        }
+
+        if (m_pool != nullptr) {
+            m_pool->destroy(m_edges, m_numEdges);
+        } else {
+            delete[] m_edges;
+        }
+    }
+
+    SparseUCTEdges(const SparseUCTEdges&) = delete;
+    SparseUCTEdges& operator=(const SparseUCTEdges&) = delete;
+
+    /**
+     * Sets the pool to allocate the records from, which must outlive the edges.
+     * Without one, they are allocated on the heap.
+     *
+     * @note Must be called before the records are allocated.
+    */
+    void setPool(Pool* pool) {
+        assert(m_edges == nullptr);
+        m_pool = pool;
+    }
+
+    Pool* getPool() const { return m_pool; }
+
+    /**
+     * Allocates one record per legal action, unless already allocated.
+     *
+     * @note Concurrent callers must hold the lock of the owning node.
+    */
+    void allocate(const ActionDist& actionMask) {
+        if (m_edges != nullptr) {
+            return;
+        }
+
+        int numEdges = 0;
+        for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
+            numEdges += (actionMask[action] != 0.0f);
+        }
+
+        m_edges = (m_pool != nullptr) ? m_pool->create(numEdges) : new Edge[numEdges] {};
+
+        int edgeIdx = 0;
+        for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
+            if (actionMask[action] != 0.0f) {
+                m_edges[edgeIdx++].m_action = action;
+            }
+        }
+
+        m_numEdges = numEdges;
+    }
+
+    /**
+     * @returns The number of edges, i.e. legal actions, or zero if not allocated yet.
+    */
+    int size() const { return m_numEdges; }
+
+    ActionIdx action(int edgeIdx) const { return m_edges[edgeIdx].m_action; }
+    bool isLegal(int, const ActionDist&) const { return true; }
+
+    /**
+     * @returns The edge index of a legal action, by linear scan.
+    */
+    int find(ActionIdx action) const {
+        for (int edgeIdx = 0; edgeIdx < m_numEdges; ++edgeIdx) {
+            if (m_edges[edgeIdx].m_action == action) {
+                return edgeIdx;
+            }
+        }
+
+        assert(false);
+        return -1;
+    }
+
+    float& numVisits(int edgeIdx) { return m_edges[edgeIdx].m_numVisits; }
+    float& totalValue(int edgeIdx) { return m_edges[edgeIdx].m_totalValue; }
+    float& prior(int edgeIdx) { return m_edges[edgeIdx].m_prior; }
+    float& policy(int edgeIdx) { return m_edges[edgeIdx].m_prior; }
+
+    const float& numVisits(int edgeIdx) const { return m_edges[edgeIdx].m_numVisits; }
+    const float& totalValue(int edgeIdx) const { return m_edges[edgeIdx].m_totalValue; }
+    const float& prior(int edgeIdx) const { return m_edges[edgeIdx].m_prior; }
+    const float& policy(int edgeIdx) const { return m_edges[edgeIdx].m_prior; }
+
+    PoolPtr<Node>& child(int edgeIdx) { return m_edges[edgeIdx].m_child; }
+    const PoolPtr<Node>& child(int edgeIdx) const { return m_edges[edgeIdx].m_child; }
+
+    Ref ref(int edgeIdx) { return { &m_edges[edgeIdx] }; }
+
+    /**
+     * @returns The edge index of the edge with the given rank by policy, zero being the most likely.
+    */
+    int rankedEdge(int rank) const { return m_edges[rank].m_rankedEdge; }
+
+    /**
+     * Writes the PUCT score of every edge into `scores`. See `scorePUCT` for `DROP_PARENT`.
+    */
+    template <bool DROP_PARENT>
+    void score(const PUCTParams& params, const ActionDist&, float* scores) const {
+        for (int edgeIdx = 0; edgeIdx < m_numEdges; ++edgeIdx) {
+            const Edge& edge = m_edges[edgeIdx];
+
+            scores[edgeIdx] = scorePUCT<DROP_PARENT>(edge.m_prior, atomicLoad(edge.m_totalValue),
+                                                     atomicLoad(edge.m_numVisits), params);
+        }
+    }
+
+    /**
+     * Writes the PUCT scores of the `width` edges most likely by policy into `scores`,
+     * by rank rather than by edge index. See `scorePUCT` for `DROP_PARENT`.
+    */
+    template <bool DROP_PARENT>
+    void scoreRanked(const PUCTParams& params, int width, float* scores) const {
+        for (int rank = 0; rank < width; ++rank) {
+            const Edge& edge = m_edges[m_edges[rank].m_rankedEdge];
+
+            scores[rank] = scorePUCT<DROP_PARENT>(edge.m_prior, atomicLoad(edge.m_totalValue),
+                                                  atomicLoad(edge.m_numVisits), params);
+        }
+    }
+
+    /**
+     * Caches the network policy on the legal actions, allocating the edges if necessary,
+     * and ranks the edges by it, ties going to the lower action.
+    */
+    void setPolicy(const ActionDist& networkPolicy, const ActionDist& actionMask) {
+        allocate(actionMask);
+
+        std::array<int16_t, ACTION_SIZE> ranked;
+
+        for (int edgeIdx = 0; edgeIdx < m_numEdges; ++edgeIdx) {
+            m_edges[edgeIdx].m_prior = networkPolicy[m_edges[edgeIdx].m_action];
+            ranked[edgeIdx] = static_cast<int16_t>(edgeIdx);
+        }
+
+        std::sort(ranked.begin(), ranked.begin() + m_numEdges, [this](int16_t a, int16_t b) {
+            return m_edges[a].m_prior > m_edges[b].m_prior || (m_edges[a].m_prior == m_edges[b].m_prior && a < b);
+        });
+
+        for (int rank = 0; rank < m_numEdges; ++rank) {
+            m_edges[rank].m_rankedEdge = ranked[rank];
+        }
+    }
+
+    /**
+     * Resets the traversal statistics, keeping the cached policy (i.e. the priors) and children.
+    */
+    void reset() {
+        for (int edgeIdx = 0; edgeIdx < m_numEdges; ++edgeIdx) {
+            m_edges[edgeIdx].m_totalValue = 0.0f;
+            m_edges[edgeIdx].m_numVisits = 0.0f;
+        }
+    }
+
+    /**
+     * @returns A copy of the statistics scattered into dense arrays indexed by action,
+     * with zeros on illegal actions.
+    */
+    Statistics snapshot() const {
+        Statistics stats {};
+
+        for (int edgeIdx = 0; edgeIdx < m_numEdges; ++edgeIdx) {
+            const Edge& edge = m_edges[edgeIdx];
+
+            stats.m_childPriors[edge.m_action] = edge.m_prior;
+            stats.m_totalValues[edge.m_action] = edge.m_totalValue;
+            stats.m_numVisits[edge.m_action] = edge.m_numVisits;
+        }
+
+        return stats;
+    }
+
+    /**
+     * @returns The number of bytes held outside of the node itself.
+    */
+    size_t heapBytes() const {
+        return m_numEdges * sizeof(Edge);
+    }
+
+private:
+    Edge* m_edges { nullptr };  // One record per legal action, ordered by action.
+    Pool* m_pool { nullptr };   // Pool the records come from, if any.
+    int m_numEdges { 0 };
+};
+
+/**
+ * Whether UCT nodes for a game use the sparse edge layout.
+ *
+ * Defaults to dense, which suits small action spaces where most actions
+ * stay legal (e.g. Connect Four). Games with large, mostly-illegal action
+ * spaces opt into the sparse layout by specializing this trait.
+ *
+ * @tparam ImplNode The implementation of the game node, e.g. `GoNode`.
+*/
+template <typename ImplNode>
+struct UseSparseUCTEdges : std::false_type {};
+
+template <>
+struct UseSparseUCTEdges<GoNode> : std::true_type {};
+
+template <>
+struct UseSparseUCTEdges<OthelloNode> : std::true_type {};
+
+/**
+ * The edge layout used by the UCT nodes of a game.
+*/
+template <typename ImplNode, typename Node, int ACTION_SIZE>
+using UCTEdges = std::conditional_t<UseSparseUCTEdges<ImplNode>::value,
+                                    SparseUCTEdges<Node, ACTION_SIZE>,
+                                    DenseUCTEdges<Node, ACTION_SIZE>>;
+
+} // namespace SPRL
+
+#endif
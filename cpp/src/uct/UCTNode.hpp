@@ -3,21 +3,27 @@
 
 #include "../games/GameNode.hpp"
 
+#include "../utils/AtomicFloat.hpp"
+#include "../utils/NodePool.hpp"
 #include "../utils/random.hpp"
+#include "../utils/SpinLock.hpp"
 
 #include "../constants.hpp"
 
+#include "TreeSnapshot.hpp"
+#include "UCTEdges.hpp"
+
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <mutex>
 
 namespace SPRL { 
 
-// Forward declaration of the UCT tree class.
-template<typename ImplNode, typename State, int ACTION_SIZE>
-class UCTTree;
-
 /**
  * Supported methods of initializing the Q values of the nodes.
 */
@@ -27,85 +33,117 @@ enum class InitQ {
     DROP_PARENT     // Todo: write description.
 };
 
+// Forward declaration of the UCT tree class.
+template<typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q>
+class UCTTree;
+
+/**
+ * Game-theoretic values of nodes, as proven by search, from the perspective of the player to move.
+*/
+enum class Proof : uint8_t {
+    UNKNOWN,  // Not proven (yet).
+    WIN,      // The player to move wins with best play.
+    LOSS,     // The player to move loses whatever they play.
+    DRAW,     // Neither player can do better than a draw.
+};
+
 /**
  * Class representing a node in the tree for the UCT algorithm.
  * 
  * @tparam ImplNode The implementation of the game node, e.g. `GoNode`.
  * @tparam State The state of the game, e.g. `GridState`.
  * @tparam ACTION_SIZE The size of the action space.
+ * @tparam INIT_Q The method to use for initializing the Q values of the nodes,
+ * fixed at compile time so that selection does not branch on it.
 */
-template <typename ImplNode, typename State, int ACTION_SIZE>
+template <typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q = InitQ::PARENT>
 class UCTNode {
 public:
     using ActionDist = GameActionDist<ACTION_SIZE>;
+    using EdgeStatistics = UCTEdgeStatistics<ACTION_SIZE>;
+    using Edges = UCTEdges<ImplNode, UCTNode, ACTION_SIZE>;
 
-    /**
-     * Holds statistics for the edges coming out of this node in the UCT tree.
-    */
-    struct EdgeStatistics {
-
-        ActionDist m_childPriors {};  // Prior from network, used to compute U.
-        ActionDist m_totalValues {};  // Total Q value accumulated on each edge.
-        ActionDist m_numVisits {};    // Number of times each edge has been traversed.
-
-        EdgeStatistics() {
-            reset();
-        }
-
-        void reset() {
-            m_childPriors.fill(0.0);
-            m_totalValues.fill(0.0);
-            m_numVisits.fill(0.0);
-        }
-    };
+    static constexpr bool DROP_PARENT = (INIT_Q == InitQ::DROP_PARENT);
 
     /**
      * Constructor for root UCT node.
      * 
-     * @param edgeStats Pointer to the edge statistics of the virtual "parent" node, held by `UCTTree`.
+     * @param parentEdge Handle to the edge from the virtual "parent" node, held by `UCTTree`.
      * @param gameNode The root game node, also held by `UCTTree`.
-     * @param dirEps The epsilon parameter for Dirichlet noise.
-     * @param dirAlpha The alpha parameter for Dirichlet noise.
-     * @param initQMethod The method to use for initializing the Q values of the nodes.
     */
-    UCTNode(EdgeStatistics* edgeStats, GameNode<ImplNode, State, ACTION_SIZE>* gameNode,
-            float dirEps = 0.25f, float dirAlpha = 0.1f, InitQ initQMethod = InitQ::PARENT)
-        : m_gameNode { gameNode }, m_parentEdgeStatistics { edgeStats },
-          m_dirEps { dirEps }, m_dirAlpha { dirAlpha }, m_initQMethod { initQMethod },
-          m_isTerminal { m_gameNode->isTerminal() }, m_actionMask { m_gameNode->getActionMask() } {
+    UCTNode(typename Edges::Ref parentEdge, GameNode<ImplNode, State, ACTION_SIZE>* gameNode)
+        : m_gameNode { gameNode }, m_parentEdge { parentEdge },
+          m_isTerminal { m_gameNode->isTerminal() }, m_player { m_gameNode->getPlayer() },
+          m_actionMask { m_gameNode->getActionMask() },
+          m_hash { m_gameNode->getHash() } {
+
+        if (m_isTerminal) {
+            setProof(terminalProof());
+        }
     }
 
     /**
      * Constructor for child UCT nodes.
      * 
      * @param parent Pointer to the parent UCT node.
-     * @param action The action taken to reach this node.
+     * @param edgeIdx The index of the edge out of the parent taken to reach this node.
      * @param gameNode The game node corresponding to this UCT node.
-     * @param dirEps The epsilon parameter for Dirichlet noise.
-     * @param dirAlpha The alpha parameter for Dirichlet noise.
-     * @param initQMethod The method to use for initializing the Q values of the nodes.
     */
-    UCTNode(UCTNode* parent, ActionIdx action, GameNode<ImplNode, State, ACTION_SIZE>* gameNode,
-            float dirEps = 0.25f, float dirAlpha = 0.1f, InitQ initQMethod = InitQ::PARENT)
-        : m_parent { parent }, m_action { action }, m_gameNode { gameNode },
-          m_dirEps { dirEps }, m_dirAlpha { dirAlpha }, m_initQMethod { initQMethod },
-          m_isTerminal { m_gameNode->isTerminal() }, m_actionMask { m_gameNode->getActionMask() },
-          m_parentEdgeStatistics { &parent->m_edgeStatistics } {
+    UCTNode(UCTNode* parent, int edgeIdx, GameNode<ImplNode, State, ACTION_SIZE>* gameNode)
+        : m_parent { parent }, m_action { parent->m_edges.action(edgeIdx) }, m_gameNode { gameNode },
+          m_isTerminal { m_gameNode->isTerminal() }, m_player { m_gameNode->getPlayer() },
+          m_actionMask { m_gameNode->getActionMask() },
+          m_hash { m_gameNode->getHash() }, m_epoch { parent->m_epoch.load() },
+          m_parentEdge { parent->m_edges.ref(edgeIdx) } {
+
+        if (m_isTerminal) {
+            setProof(terminalProof());
+        }
+    }
+
+    /**
+     * @returns The pool that children of this node are allocated from,
+     * or `nullptr` if they are allocated on the heap.
+    */
+    NodePool<UCTNode>* getPool() const {
+        return m_pool;
+    }
 
+    /**
+     * @returns A copy of the edge statistics of this node, indexed by action
+     * (zero on illegal actions) regardless of the edge layout.
+    */
+    EdgeStatistics getEdgeStatistics() const {
+        return m_edges.snapshot();
     }
 
     /**
-     * @returns A readonly pointer to the edge statistics of this node.
+     * @returns The number of bytes used by this node, including its edges
+     * but not its children or game node.
     */
-    const EdgeStatistics* getEdgeStatistics() const {
-        return &m_edgeStatistics;
+    size_t memoryUsage() const {
+        return sizeof(UCTNode) + m_edges.heapBytes();
     }
 
     /**
      * @returns The player to move at this node.
     */
     Player getPlayer() const {
-        return m_gameNode->getPlayer();
+        return m_player;
+    }
+
+    /**
+     * @returns A readonly reference to the mask of legal actions at this node.
+    */
+    const ActionDist& getActionMask() const {
+        return m_actionMask;
+    }
+
+    /**
+     * @returns The hash of the game state, for detecting transpositions.
+    */
+    ZobristHash getHash() const {
+        return m_hash;
     }
 
     /**
@@ -115,6 +153,34 @@ public:
         return m_isTerminal;
     }
 
+    /**
+     * @returns The proven value of the node, from the perspective of the player to move.
+     * Terminal nodes are always proven; others only by a search with the solver on.
+    */
+    Proof getProof() const {
+        return m_proof.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @returns Whether the game-theoretic value of the node is known.
+    */
+    bool isProven() const {
+        return getProof() != Proof::UNKNOWN;
+    }
+
+    /**
+     * @returns The exact value of a proven node, from the perspective of the player to move.
+    */
+    Value provenValue() const {
+        assert(isProven());
+
+        switch (getProof()) {
+        case Proof::WIN:  return 1.0f;
+        case Proof::LOSS: return -1.0f;
+        default:          return 0.0f;
+        }
+    }
+
     /**
      * @returns The game state of the underlying game node.
     */
@@ -137,20 +203,38 @@ public:
     }
 
     /**
-     * @returns A reference to the current number of visits to this node.
+     * @returns The current number of visits to this node.
+    */
+    float N() const { return atomicLoad(m_parentEdge.numVisits()); }
+
+    /**
+     * @returns The current total value of this node.
+    */
+    float W() const { return atomicLoad(m_parentEdge.totalValue()); }
+
+    /**
+     * Atomically records a virtual loss on the edge into this node,
+     * to discount other traversals from retracing the same path.
     */
-    float& N() { return m_parentEdgeStatistics->m_numVisits[m_action]; }
+    void addVirtualLoss() {
+        atomicAdd(m_parentEdge.numVisits(), 1.0f);
+        atomicAdd(m_parentEdge.totalValue(), -1.0f);
+    }
 
     /**
-     * @returns A reference to the current total value of this node.
+     * Atomically adds to the total value of the edge into this node.
+     * 
+     * @param delta The amount to add, including any reverted virtual loss.
     */
-    float& W() { return m_parentEdgeStatistics->m_totalValues[m_action]; }
+    void addValue(float delta) {
+        atomicAdd(m_parentEdge.totalValue(), delta);
+    }
 
     /**
      * @returns The current average action value of this node, as described in UCT.
     */
     float Q() {
-        if (m_initQMethod == InitQ::DROP_PARENT) {
+        if constexpr (DROP_PARENT) {
             if (N() == 0) {
                 // Return the parent Q value!
                 return m_parent->Q();
@@ -163,51 +247,51 @@ public:
     }
 
     /**
-     * @param action The action index of the child to query.
+     * @param edgeIdx The edge index of the child to query (the action itself under the dense layout).
      * 
      * @returns The number of visits to a particular child.
     */
-    float child_N(ActionIdx action) const { return m_edgeStatistics.m_numVisits[action]; }
+    float child_N(int edgeIdx) const { return atomicLoad(m_edges.numVisits(edgeIdx)); }
 
     /**
-     * @param action The action index of the child to query.
+     * @param edgeIdx The edge index of the child to query (the action itself under the dense layout).
      * 
      * @returns The total value of a particular child.
     */
-    float child_W(ActionIdx action) const { return m_edgeStatistics.m_totalValues[action]; }
+    float child_W(int edgeIdx) const { return atomicLoad(m_edges.totalValue(edgeIdx)); }
 
     /**
-     * @param action The action index of the child to query.
+     * @param edgeIdx The edge index of the child to query (the action itself under the dense layout).
      * 
      * @returns The prior probability of selecting a particular child.
     */
-    float child_P(ActionIdx action) const { return m_edgeStatistics.m_childPriors[action]; }
+    float child_P(int edgeIdx) const { return m_edges.prior(edgeIdx); }
 
     /**
-     * @param action The action index of the child to query.
+     * @param edgeIdx The edge index of the child to query (the action itself under the dense layout).
      * 
      * @returns The average action value of a particular child, as described in UCT.
     */
-    float child_Q(ActionIdx action) {
-        if (m_initQMethod == InitQ::DROP_PARENT) {
-            if (child_N(action) == 0) {
+    float child_Q(int edgeIdx) {
+        if constexpr (DROP_PARENT) {
+            if (child_N(edgeIdx) == 0) {
                 // Return your own Q value!
                 return Q();
             }else{
-                return child_W(action) / child_N(action);
+                return child_W(edgeIdx) / child_N(edgeIdx);
             }
         }else{
-            return child_W(action) / (1 + child_N(action)); 
+            return child_W(edgeIdx) / (1 + child_N(edgeIdx)); 
         }
     }
 
     /**
-     * @param action The action index of the child to query.
+     * @param edgeIdx The edge index of the child to query (the action itself under the dense layout).
      * 
      * @returns The uncertainty value of a particular child, as described in the UCT algorithm.
     */
-    float child_U(ActionIdx action) {
-        return child_P(action) * std::sqrt(N()) / (1 + child_N(action));  // Adding 1 avoids division by zero.
+    float child_U(int edgeIdx) {
+        return child_P(edgeIdx) * std::sqrt(N()) / (1 + child_N(edgeIdx));  // Adding 1 avoids division by zero.
     }
 
     /**
@@ -219,68 +303,214 @@ public:
      * non-terminals that are evaluated and expanded.
     */
     ActionIdx bestAction(float uWeight) {
+        return m_edges.action(selectEdge(uWeight));
+    }
+
+    /**
+     * @param uWeight The weighting of the U value compared to the Q value.
+     * @param useProofs Whether to steer by the proven children: always play into
+     * a child lost for the opponent, and never into any other proven child, as
+     * its value is already known, unless every child is proven.
+     * @param pruneWidth With edges ranked by policy, the number of most likely edges
+     * to consider at first, widened by progressive unpruning (see `unprunedWidth`),
+     * or zero to consider every edge. Ignored under the dense layout.
+     * 
+     * @returns The edge index of the best move according to the UCT algorithm.
+     * 
+     * @note Can only be applied on active nodes, i.e.
+     * non-terminals that are evaluated and expanded.
+    */
+    int selectEdge(float uWeight, bool useProofs = false, int pruneWidth = 0) {
         assert(!m_isTerminal);
 
         assert(m_isExpanded);
         assert(m_isNetworkEvaluated);
 
-        std::vector<ActionIdx> bestActions;
-        float bestValue = -std::numeric_limits<float>::infinity();
+        // Everything that does not depend on the edge is computed once, up front.
+        PUCTParams params { uWeight * std::sqrt(N()), 0.0f };
+        if constexpr (DROP_PARENT) {
+            params.m_unvisitedQ = Q();
+        }
 
-        for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
-            if (m_actionMask[action] == 0.0f) {
-                // Illegal action, skip.
-                continue;
+        alignas(64) float scores[ACTION_SIZE];
+        bool anyProven = useProofs && m_numProvenChildren.load(std::memory_order_relaxed) > 0;
+
+        if constexpr (Edges::RANKS_BY_POLICY) {
+            int width = (pruneWidth > 0) ? unprunedWidth(pruneWidth) : m_edges.size();
+
+            if (width < m_edges.size()) {
+                // Only score the most likely edges, by rank, so the cost does not grow with the legal moves.
+                m_edges.template scoreRanked<DROP_PARENT>(params, width, scores);
+
+                if (!anyProven || scoreProvenChildren(scores, width, true)) {
+                    return m_edges.rankedEdge(pickBestPUCT(scores, width));
+                }
+
+                // Every unpruned child is proven: fall back to considering them all.
+            }
+        }
+
+        m_edges.template score<DROP_PARENT>(params, m_actionMask, scores);
+
+        if (anyProven && !scoreProvenChildren(scores, m_edges.size(), false)) {
+            // Every child is proven, so this node is too: pick among them as usual.
+            m_edges.template score<DROP_PARENT>(params, m_actionMask, scores);
+        }
+
+        return pickBestPUCT(scores, m_edges.size());
+    }
+
+    /**
+     * Like `selectEdge`, but only considers the edges whose children already exist,
+     * for when the node budget forbids creating any more.
+     *
+     * @param uWeight The weighting of the U value compared to the Q value.
+     * @param useProofs Whether to steer by the proven children, as in `selectEdge`.
+     *
+     * @returns The edge index of the best existing child according to the UCT algorithm,
+     * or -1 if there is no child to pick.
+     *
+     * @note Can only be applied on active nodes, i.e.
+     * non-terminals that are evaluated and expanded.
+    */
+    int selectExistingEdge(float uWeight, bool useProofs = false) {
+        constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+
+        assert(!m_isTerminal);
+
+        assert(m_isExpanded);
+        assert(m_isNetworkEvaluated);
+
+        PUCTParams params { uWeight * std::sqrt(N()), 0.0f };
+        if constexpr (DROP_PARENT) {
+            params.m_unvisitedQ = Q();
+        }
+
+        alignas(64) float scores[ACTION_SIZE];
+        m_edges.template score<DROP_PARENT>(params, m_actionMask, scores);
+
+        if (useProofs && m_numProvenChildren.load(std::memory_order_relaxed) > 0
+                && !scoreProvenChildren(scores, m_edges.size(), false)) {
+            // Every child is proven, so this node is too: pick among them as usual.
+            m_edges.template score<DROP_PARENT>(params, m_actionMask, scores);
+        }
+
+        bool anyLeft = false;
+        {
+            std::lock_guard<SpinLock> guard { m_lock };
+
+            for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+                if (m_edges.child(edgeIdx) == nullptr) {
+                    scores[edgeIdx] = NEG_INF;
+                }
+
+                anyLeft = anyLeft || (scores[edgeIdx] != NEG_INF);
             }
+        }
 
-            const float value = child_Q(action) + uWeight * child_U(action);
+        return anyLeft ? pickBestPUCT(scores, m_edges.size()) : -1;
+    }
 
-            if (value > bestValue) {
-                bestValue = value;
-                bestActions.clear();
-                
-                bestActions.push_back(action);
+    /**
+     * Progressive unpruning: selection considers only the `pruneWidth` edges most likely by
+     * policy at first, then one more edge once the node has `UNPRUNE_VISITS` visits, and
+     * another each time its visits grow by a factor of `UNPRUNE_GROWTH` from there.
+     * Visits never decrease within a search, so every visited edge stays within the width.
+     * 
+     * @param pruneWidth The number of edges to consider at first.
+     * 
+     * @returns The number of edges, most likely first, to consider at the current visits.
+    */
+    int unprunedWidth(int pruneWidth) {
+        float numVisits = N();
+        if (numVisits < UNPRUNE_VISITS) {
+            return pruneWidth;
+        }
+
+        return pruneWidth + 1 + static_cast<int>(std::log(numVisits / UNPRUNE_VISITS) / std::log(UNPRUNE_GROWTH));
+    }
 
-            } else if (value == bestValue) {
-                bestActions.push_back(action);
+    /**
+     * @param action The action to the child.
+     * 
+     * @returns A raw pointer to the child along the action, or nullptr if it has not been created.
+     * 
+     * @note Not safe to call concurrently with search.
+    */
+    const UCTNode* getChild(ActionIdx action) const {
+        if (m_isTerminal || m_actionMask[action] == 0.0f || m_edges.size() == 0) {
+            return nullptr;
+        }
+
+        return m_edges.child(m_edges.find(action)).get();
+    }
+
+    /**
+     * @returns The proof of every child from the perspective of the player to move here, indexed
+     * by action, with `Proof::UNKNOWN` for illegal actions and children not created or not proven.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    std::array<Proof, ACTION_SIZE> getChildProofs() const {
+        std::array<Proof, ACTION_SIZE> proofs;
+        proofs.fill(Proof::UNKNOWN);
+
+        if (m_isTerminal) {
+            return proofs;
+        }
+
+        for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+            if (!m_edges.isLegal(edgeIdx, m_actionMask)) {
+                continue;
+            }
+
+            if (const UCTNode* child = m_edges.child(edgeIdx).get(); child != nullptr) {
+                proofs[m_edges.action(edgeIdx)] = child->proofFor(getPlayer());
             }
         }
 
-        assert(!bestActions.empty());
-        return bestActions[GetRandom().UniformInt(0, bestActions.size() - 1)];
+        return proofs;
     }
 
     /**
+     * @param action The action to the child.
+     * @param snapshot The snapshot to restore a new child from, if this node was restored from it.
+     * 
      * @returns A raw pointer to the child of the current non-terminal node.
      * 
      * @note If the child does not already exist, creates it.
+     * Safe to call concurrently from multiple search threads.
     */
-    UCTNode* getAddChild(ActionIdx action) {
+    UCTNode* getAddChild(ActionIdx action, const TreeSnapshot* snapshot = nullptr) {
         assert(!m_isTerminal);
 
-        if (m_children[action] == nullptr) {
-            // Child doesn't exist, so we create it.
-            m_children[action] = std::make_unique<UCTNode>(
-                this, action, m_gameNode->getAddChild(action), m_dirEps, m_dirAlpha, m_initQMethod);
+        std::lock_guard<SpinLock> guard { m_lock };
 
-            // Handle Q-initialization based on the method.
-            switch (m_initQMethod) {
-            case InitQ::ZERO:
-                m_edgeStatistics.m_totalValues[action] = 0.0f;
-                break;
-            case InitQ::PARENT:
-                m_edgeStatistics.m_totalValues[action] = m_isNetworkEvaluated ? m_networkValue : 0.0f;
-                break;
-            case InitQ::DROP_PARENT:
-                // This value is never used! Set to 0, so that
-                // after the child is expanded and its network eval is computed,
-                // it increments to that correct value.
-                m_edgeStatistics.m_totalValues[action] = 0.0f;
-                break;
-            }
+        m_edges.allocate(m_actionMask);
+        return getAddChildLocked(m_edges.find(action), snapshot);
+    }
+
+    /**
+     * @param edgeIdx The index of the edge to the child.
+     * @param mayCreate Whether to create the child if it does not exist yet.
+     * @param snapshot The snapshot to restore a new child from, if this node was restored from it.
+     * 
+     * @returns A raw pointer to the child along the given edge, or `nullptr`
+     * if it does not exist and may not be created.
+     * 
+     * @note Like `getAddChild`, but skips looking up the edge of an action.
+     * Can only be applied on nodes whose edges are allocated, e.g. active nodes.
+    */
+    UCTNode* getAddChildAt(int edgeIdx, bool mayCreate = true, const TreeSnapshot* snapshot = nullptr) {
+        assert(!m_isTerminal);
+
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        if (!mayCreate && m_edges.child(edgeIdx) == nullptr) {
+            return nullptr;
         }
 
-        return m_children[action].get();
+        return getAddChildLocked(edgeIdx, snapshot);
     }
 
     /**
@@ -288,16 +518,19 @@ public:
      * 
      * @param networkPolicy The policy output of the network.
      * @param valueEstimate The value output of the network.
+     * 
+     * @note Concurrent callers must hold `m_lock`.
     */
     void addNetworkOutput(const ActionDist& networkPolicy, Value valueEstimate) {
         assert(!m_isTerminal);
         assert(!m_isNetworkEvaluated);
         assert(!m_isExpanded);
 
-        m_isNetworkEvaluated = true;
-
-        m_networkPolicy = networkPolicy;
+        m_edges.setPolicy(networkPolicy, m_actionMask);
         m_networkValue = valueEstimate;
+
+        // Publish only after the outputs are written, for lock-free readers.
+        m_isNetworkEvaluated = true;
     }
 
     /**
@@ -308,43 +541,48 @@ public:
      * @param addNoise Whether to add Dirichlet noise to the priors.
      * It is the caller's responsibility to set this to true when expanding
      * the current decision node during training.
+     * @param dirEps The epsilon parameter for Dirichlet noise.
+     * @param dirAlpha The alpha parameter for Dirichlet noise.
+     * 
+     * @note Concurrent callers must hold `m_lock`.
     */
-    void expand(bool addNoise) {
+    void expand(bool addNoise, float dirEps, float dirAlpha) {
         assert(!m_isTerminal);
         assert(!m_isExpanded);
         assert(m_isNetworkEvaluated);
 
-        m_isExpanded = true;
-
         int numLegal = 0;
-        for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
-            if (m_actionMask[action] == 0.0f) {
+        for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+            if (!m_edges.isLegal(edgeIdx, m_actionMask)) {
                 // Illegal action, skip.
                 continue;
             }
 
-            m_edgeStatistics.m_childPriors[action] = m_networkPolicy[action];
+            m_edges.prior(edgeIdx) = m_edges.policy(edgeIdx);
             ++numLegal;
         }
 
         if (addNoise) {
-            std::vector<float> noise (numLegal);
-            GetRandom().Dirichlet(m_dirAlpha, noise);
+            float noise[ACTION_SIZE];
+            GetRandom().Dirichlet(dirAlpha, noise, numLegal);
 
             int readIdx = 0;
-            for (ActionIdx action = 0; action < ACTION_SIZE; ++action) {
-                if (m_actionMask[action] == 0.0f) {
+            for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+                if (!m_edges.isLegal(edgeIdx, m_actionMask)) {
                     // Illegal action, skip.
                     continue;
                 }
 
-                m_edgeStatistics.m_childPriors[action]
-                    = (1.0 - m_dirEps) * m_edgeStatistics.m_childPriors[action]
-                            + m_dirEps * noise[readIdx];
+                m_edges.prior(edgeIdx)
+                    = (1.0 - dirEps) * m_edges.prior(edgeIdx)
+                            + dirEps * noise[readIdx];
                                                         
                 ++readIdx;
             }
         }
+
+        // Publish only after the priors are written, since selection reads them without locking.
+        m_isExpanded = true;
     }
 
     /**
@@ -356,9 +594,9 @@ public:
     void pruneChildrenExcept(ActionIdx action) {
         assert(!m_isTerminal);
 
-        for (ActionIdx i = 0; i < ACTION_SIZE; ++i) {
-            if (i != action) {
-                m_children[i] = nullptr;
+        for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+            if (m_edges.action(edgeIdx) != action) {
+                m_edges.child(edgeIdx) = nullptr;
             }
         }
 
@@ -366,28 +604,268 @@ public:
     }
 
 private:
-    UCTNode* m_parent { nullptr };  // Raw pointer to the parent, nullptr if root.
-    std::array<std::unique_ptr<UCTNode>, ACTION_SIZE> m_children {};  // Parent owns children.
+    /**
+     * Works out the proof of the node from those of its children: a win if any
+     * child is lost for the player to move there, a loss if every child is won
+     * for them, and a draw if every child is proven and the best is a draw.
+     * 
+     * @returns The proof, `Proof::UNKNOWN` if the children do not settle it.
+     * 
+     * @note Can only be applied on nodes whose edges are allocated, e.g. active nodes.
+     * Safe to call concurrently from multiple search threads.
+    */
+    Proof deduceProof() {
+        assert(!m_isTerminal);
+
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        bool allProven = true;
+        bool anyDraw = false;
+
+        for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+            if (!m_edges.isLegal(edgeIdx, m_actionMask)) {
+                continue;
+            }
+
+            const UCTNode* child = m_edges.child(edgeIdx).get();
+            Proof proof = (child == nullptr) ? Proof::UNKNOWN : child->proofFor(getPlayer());
+
+            if (proof == Proof::WIN) {
+                return Proof::WIN;
+            }
+
+            allProven = allProven && (proof != Proof::UNKNOWN);
+            anyDraw = anyDraw || (proof == Proof::DRAW);
+        }
+
+        if (!allProven) {
+            return Proof::UNKNOWN;
+        }
+
+        return anyDraw ? Proof::DRAW : Proof::LOSS;
+    }
+
+    /**
+     * Records the proof of a node that was not proven before.
+     * 
+     * @returns Whether the proof was recorded, i.e. it is known and no other thread got there first.
+    */
+    bool setProof(Proof proof) {
+        Proof unknown = Proof::UNKNOWN;
+        if (proof == Proof::UNKNOWN
+            || !m_proof.compare_exchange_strong(unknown, proof, std::memory_order_acq_rel)) {
+            return false;
+        }
+
+        if (m_parent != nullptr) {
+            m_parent->m_numProvenChildren.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return true;
+    }
+
+    /**
+     * @returns The proof of a terminal node, from its rewards.
+    */
+    Proof terminalProof() const {
+        Value reward = getRewards()[static_cast<int>(getPlayer())];
+        return (reward > 0.0f) ? Proof::WIN : (reward < 0.0f) ? Proof::LOSS : Proof::DRAW;
+    }
+
+    /**
+     * @returns The proof of the node from the perspective of the given player.
+    */
+    Proof proofFor(Player player) const {
+        Proof proof = getProof();
+
+        if (player == getPlayer() || proof == Proof::DRAW) {
+            return proof;
+        }
+
+        return (proof == Proof::WIN) ? Proof::LOSS : (proof == Proof::LOSS) ? Proof::WIN : proof;
+    }
+
+    /**
+     * Overrides the scores of the proven children: positive infinity for those lost
+     * for the opponent, and negative infinity, like illegal edges, for the rest.
+     * 
+     * @param scores The scores to override.
+     * @param numScores The number of scores.
+     * @param ranked Whether the scores are by rank by policy, as from `scoreRanked`, rather than by edge index.
+     * 
+     * @returns Whether any legal child is left unproven or winning.
+    */
+    bool scoreProvenChildren(float* scores, int numScores, bool ranked) {
+        constexpr float INF = std::numeric_limits<float>::infinity();
+
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        bool anyLeft = false;
+        for (int scoreIdx = 0; scoreIdx < numScores; ++scoreIdx) {
+            int edgeIdx = scoreIdx;
+            if constexpr (Edges::RANKS_BY_POLICY) {
+                edgeIdx = ranked ? m_edges.rankedEdge(scoreIdx) : scoreIdx;
+            }
+
+            if (!m_edges.isLegal(edgeIdx, m_actionMask)) {
+                continue;
+            }
+
+            const UCTNode* child = m_edges.child(edgeIdx).get();
+            Proof proof = (child == nullptr) ? Proof::UNKNOWN : child->proofFor(getPlayer());
+
+            if (proof == Proof::UNKNOWN) {
+                anyLeft = true;
+            } else if (proof == Proof::WIN) {
+                scores[scoreIdx] = INF;  // The opponent is lost there.
+                anyLeft = true;
+            } else {
+                scores[scoreIdx] = -INF;
+            }
+        }
+
+        return anyLeft;
+    }
+
+    /**
+     * Restores the network outputs, proof and, if they were in use, the edge statistics
+     * of a new node from its record in a snapshot. Statistics are stamped with the epoch
+     * the snapshot was loaded in, so that they are reset if the tree has moved on since.
+     * 
+     * Children are left to be restored when search first reaches them, except for proven
+     * ones, which are restored right away so that they steer selection from the start.
+     * 
+     * @param snapshot The snapshot to restore from.
+     * @param nodeIdx The index of the node record.
+     * 
+     * @returns Whether the record fit the node. If not, the node is left fresh.
+     * 
+     * @note Must be applied before the node is published to other threads.
+    */
+    bool restore(const TreeSnapshot& snapshot, int nodeIdx) {
+        const SnapshotNode& record = snapshot.node(nodeIdx);
+        bool hasEdges = !m_isTerminal && record.m_isNetworkEvaluated;
+
+        if (hasEdges) {
+            m_edges.allocate(m_actionMask);
+        }
+
+        // A record that does not fit the node, as from a damaged file, is ignored and the node starts fresh.
+        if (record.m_proof > static_cast<uint8_t>(Proof::DRAW)
+            || (hasEdges && static_cast<int>(record.m_numEdges) != m_edges.size())) {
+            return false;
+        }
+
+        m_snapshotIdx = nodeIdx;
+        m_epoch.store(snapshot.getEpoch(), std::memory_order_relaxed);
+        setProof(static_cast<Proof>(record.m_proof));
+
+        if (!hasEdges) {
+            return true;
+        }
+
+        ActionDist policy {};
+        for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+            policy[m_edges.action(edgeIdx)] = snapshot.edge(nodeIdx, edgeIdx).m_policy;
+        }
+
+        addNetworkOutput(policy, record.m_networkValue);
+
+        if (record.m_isExpanded) {
+            for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+                const SnapshotEdge& edge = snapshot.edge(nodeIdx, edgeIdx);
+
+                m_edges.prior(edgeIdx) = edge.m_prior;
+                m_edges.totalValue(edgeIdx) = edge.m_totalValue;
+                m_edges.numVisits(edgeIdx) = edge.m_numVisits;
+            }
+
+            m_isExpanded = true;
+        }
+
+        for (int edgeIdx = 0; edgeIdx < m_edges.size(); ++edgeIdx) {
+            int childIdx = snapshot.child(nodeIdx, edgeIdx);
+
+            if (childIdx >= 0 && static_cast<Proof>(snapshot.node(childIdx).m_proof) != Proof::UNKNOWN) {
+                getAddChildLocked(edgeIdx, &snapshot);
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Creates the child along the given edge if it does not exist yet, restoring
+     * it from the snapshot if this node was restored from it and the child was saved too.
+     * 
+     * @note The caller must hold `m_lock`.
+    */
+    UCTNode* getAddChildLocked(int edgeIdx, const TreeSnapshot* snapshot) {
+        PoolPtr<UCTNode>& slot = m_edges.child(edgeIdx);
+
+        if (slot == nullptr) {
+            // Child doesn't exist, so we create it, in our pool if we have one.
+            GameNode<ImplNode, State, ACTION_SIZE>* childGameNode = m_gameNode->getAddChild(m_edges.action(edgeIdx));
+
+            UCTNode* child = (m_pool != nullptr)
+                ? m_pool->create(this, edgeIdx, childGameNode)
+                : new UCTNode(this, edgeIdx, childGameNode);
+
+            child->m_pool = m_pool;
+            child->m_edges.setPool(m_edges.getPool());
+
+            int childIdx = (snapshot != nullptr && m_snapshotIdx >= 0) ? snapshot->child(m_snapshotIdx, edgeIdx) : -1;
+            if (childIdx >= 0) {
+                child->restore(*snapshot, childIdx);
+            }
+
+            slot = PoolPtr<UCTNode> { child };
+
+            // An edge restored from a snapshot with visits already holds its value.
+            if (child_N(edgeIdx) > 0.0f) {
+                return child;
+            }
+
+            // Handle Q-initialization based on the method.
+            if constexpr (INIT_Q == InitQ::PARENT) {
+                atomicStore(m_edges.totalValue(edgeIdx), m_isNetworkEvaluated ? m_networkValue : 0.0f);
+            } else {
+                // Under DROP_PARENT this value is never used! Set to 0, so that
+                // after the child is expanded and its network eval is computed,
+                // it increments to that correct value.
+                atomicStore(m_edges.totalValue(edgeIdx), 0.0f);
+            }
+        }
+
+        return slot.get();
+    }
+
+    UCTNode* m_parent { nullptr };          // Raw pointer to the parent, nullptr if root.
+    NodePool<UCTNode>* m_pool { nullptr };  // Pool to allocate children from, if any.
 
     ActionIdx m_action { 0 };                            // Action index taken into this node, 0 if root.
+    int32_t m_snapshotIdx { -1 };                        // Index of the record restored from, -1 if none.
     GameNode<ImplNode, State, ACTION_SIZE>* m_gameNode;  // Pointer to current game node.
     bool m_isTerminal;                                   // Whether the current node is terminal.
+    Player m_player;                                     // Player to move, cached off the game node for backup.
     const ActionDist& m_actionMask;                      // Mask of legal actions.
+    ZobristHash m_hash;                                  // Hash of the game state.
+
+    std::atomic<bool> m_isExpanded { false };          // Whether node has been expanded.
+    std::atomic<bool> m_isNetworkEvaluated { false };  // Whether node has been evaluated by the network.
+    std::atomic<uint32_t> m_epoch { 0 };               // Search epoch of the tree when last reset.
 
-    bool m_isExpanded { false };          // Whether node has been expanded.
-    bool m_isNetworkEvaluated { false };  // Whether node has been evaluated by the network.
+    std::atomic<Proof> m_proof { Proof::UNKNOWN };  // Proven value, kept across epochs.
+    std::atomic<int> m_numProvenChildren { 0 };     // Number of children with a proof.
 
-    ActionDist m_networkPolicy {};  // Cached network policy output.
-    float m_networkValue {};        // Cached network value output.
+    SpinLock m_lock {};  // Guards child creation and evaluation/expansion under parallel search.
 
-    EdgeStatistics m_edgeStatistics {};         // Edge stats out of this node.
-    EdgeStatistics* m_parentEdgeStatistics {};  // Pointer to edge stats out of parent.
+    float m_networkValue {};  // Cached network value output.
 
-    float m_dirEps {};                      // Dirichlet noise epsilon.
-    float m_dirAlpha {};                    // Dirichlet noise alpha.
-    InitQ m_initQMethod { InitQ::PARENT };  // Method to use for initializing Q values.
+    Edges m_edges {};                     // Edges out of this node, with the cached network policy and children.
+    typename Edges::Ref m_parentEdge {};  // Handle to the edge out of parent.
 
-    friend class UCTTree<ImplNode, State, ACTION_SIZE>;
+    friend class UCTTree<ImplNode, State, ACTION_SIZE, INIT_Q>;
 };
 
 } // namespace SPRL
@@ -5,10 +5,27 @@
 #include "../networks/INetwork.hpp"
 #include "../symmetry/ISymmetrizer.hpp"
 
+#include "BatchSizeTuner.hpp"
+#include "TranspositionTable.hpp"
+#include "TreeSnapshot.hpp"
 #include "UCTNode.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
 namespace SPRL {
@@ -19,84 +36,988 @@ namespace SPRL {
  * @tparam ImplNode The implementation of the game node.
  * @tparam State The state of the game.
  * @tparam ACTION_SIZE The number of actions in the game.
+ * @tparam INIT_Q The method for initializing Q values, see `UCTNode`.
 */
-template <typename ImplNode, typename State, int ACTION_SIZE>
+template <typename ImplNode, typename State, int ACTION_SIZE, InitQ INIT_Q = InitQ::PARENT>
 class UCTTree {
 public:
-    using UNode = UCTNode<ImplNode, State, ACTION_SIZE>;
+    using UNode = UCTNode<ImplNode, State, ACTION_SIZE, INIT_Q>;
 
     /**
      * Constructs a UCT tree rooted at the initial state of the game.
-     * 
+     *
      * @param gameRoot The root node of the game tree.
      * @param dirEps The epsilon value for the Dirichlet noise.
      * @param dirAlpha The alpha value for the Dirichlet noise.
-     * @param initQMethod The method for initializing Q values.
      * @param symmetrizer The symmetrizer for the game state.
      * @param addNoise Whether to add Dirichlet noise to the decision node.
+     * @param useHugePages Whether to back the node pools with transparent huge pages.
+     * @param transpositions How to exploit transposed positions, through a transposition table.
+     * @param maxNodes The most UCT nodes to keep in the tree, or zero for no limit.
+     * @param solver Whether to prove nodes won, lost, or drawn from the terminals up, and steer search by the proofs.
     */
     UCTTree(std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> gameRoot,
-            float dirEps, float dirAlpha, InitQ initQMethod,
-            ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true)
+            float dirEps, float dirAlpha,
+            ISymmetrizer<State, ACTION_SIZE>* symmetrizer, bool addNoise = true,
+            bool useHugePages = false, Transpositions transpositions = Transpositions::NONE,
+            size_t maxNodes = 0, bool solver = false)
 
-        : m_edgeStatistics {},
+        : m_gameNodePool { useHugePages },
+          m_uctNodePool { useHugePages },
+          m_edgePool { useHugePages },
+          m_rootEdge {},
           m_gameRoot { std::move(gameRoot) },
           m_uctRoot { std::make_unique<UNode>(
-            &m_edgeStatistics, m_gameRoot.get(), dirEps, dirAlpha, initQMethod) },
+            m_rootEdge.ref(), m_gameRoot.get()) },
           m_decisionNode { m_uctRoot.get() },
           m_dirEps { dirEps },
           m_dirAlpha { dirAlpha },
-          m_initQMethod { initQMethod },
           m_addNoise { addNoise },
-          m_symmetrizer { symmetrizer } {
+          m_symmetrizer { symmetrizer },
+          m_transpositions { transpositions },
+          m_maxNodes { maxNodes },
+          m_solver { solver } {
 
+        // All descendants of the roots, and the edges of the UCT nodes, are allocated from the pools.
+        m_gameRoot->setPool(&m_gameNodePool);
+        m_uctRoot->m_pool = &m_uctNodePool;
+        m_uctRoot->m_edges.setPool(&m_edgePool);
+
+        if (m_transpositions != Transpositions::NONE) {
+            m_transpositionTable = std::make_unique<TranspositionTable<ACTION_SIZE>>();
+        }
+    }
+
+    /**
+     * @returns A readonly pointer to the decision node.
+    */
+    const UNode* getDecisionNode() {
+        return m_decisionNode;
+    }
+
+    /**
+     * Sets whether to add Dirichlet noise to the decision node, from the next search on.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    void setAddNoise(bool addNoise) {
+        m_addNoise = addNoise;
+    }
+
+    /**
+     * Sets the tuner to size batches of search with, or nullptr to use the sizes given to `search`.
+     * The tuner only picks the queue size; the traversals per batch keep their ratio to it.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    void setBatchSizeTuner(BatchSizeTuner* tuner) {
+        m_batchSizeTuner = tuner;
+    }
+
+    /**
+     * Sets whether to top up batches that come out short of the queue size with speculative
+     * leaves: the unevaluated children of the most visited nodes, by expected visits. They are
+     * evaluated alongside the selected leaves and cached gray, but not backed up, so a later
+     * traversal reaching one expands it without waiting on the network. Worth it where larger
+     * batches cost the network little more than small ones.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    void setSpeculativeFill(bool speculativeFill) {
+        m_speculativeFill = speculativeFill;
+    }
+
+    /**
+     * Sets how many moves, most likely by policy first, selection considers at each node below
+     * the decision node, before progressive unpruning widens it (see `UCTNode::unprunedWidth`),
+     * or zero to consider every legal move. The decision node always considers every move,
+     * so that noise, Gumbel sampling and the policy targets cover them all.
+     *
+     * Only applies to games whose nodes use the sparse edge layout, which ranks the edges.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    void setPruneWidth(int pruneWidth) {
+        m_pruneWidth = pruneWidth;
+    }
+
+    /**
+     * @returns The number of UCT nodes in the tree, including the ancestors of the decision node.
+    */
+    size_t getNumNodes() const {
+        return 1 + m_uctNodePool.numLive();
+    }
+
+    /**
+     * @returns The number of bytes taken up by the UCT and game nodes of the tree, including
+     * the heap memory they report owning (e.g. sparse edges or Go move history).
+    */
+    size_t getMemoryUsage() const {
+        return sizeof(UNode) + sizeof(ImplNode) + m_gameRoot->heapBytes()
+            + m_uctNodePool.bytesInUse() + m_edgePool.bytesInUse()
+            + m_gameNodePool.bytesInUse() + m_gameNodePool.heapBytesInUse();
+    }
+
+    /**
+     * @returns A readonly pointer to the transposition table, or `nullptr` if not in use.
+    */
+    const TranspositionTable<ACTION_SIZE>* getTranspositionTable() const {
+        return m_transpositionTable.get();
+    }
+
+    /**
+     * Runs `numTraversals` traversals of search from the decision node,
+     * alternating between selecting leaves and evaluating them in batches.
+     *
+     * With `numThreads > 1`, performs tree-parallel search: every thread
+     * descends the same tree concurrently, relying on atomic edge statistics
+     * and virtual losses to spread the threads out over different paths.
+     * Calls into the network are serialized unless it is thread-safe, so threads
+     * overlap their selection and backup work with each other's network evaluations.
+     *
+     * With `pipelined`, each thread also double-buffers its batches: while one batch
+     * is being evaluated on a separate, long-lived thread, the next is selected (under virtual loss)
+     * and sent off, and only then are the results of the first applied. This hides
+     * the inference latency behind tree work, at the cost of each batch being selected
+     * without the results of the batch before it.
+     *
+     * With `stopEarly`, the search also stops as soon as the most visited child of the
+     * decision node leads the runner-up by more visits than there are traversals left,
+     * since then no remaining traversal can change which child is most visited.
+     * Checked between batches, so only worth it when the move is picked greedily.
+     *
+     * The search also stops at the `deadline`, again checked between batches, so it may run
+     * over by up to a batch. It never stops on time before some child of the decision
+     * node has been visited, so that there is always a move to pick.
+     *
+     * Another thread may also stop the search by raising the `stopSignal`, e.g. to end
+     * pondering when the opponent moves. The search then returns after the current batch.
+     *
+     * @param numTraversals The number of traversals to perform in total.
+     * @param maxBatchSize The maximum number of traversals per batch of search.
+     * @param maxQueueSize The maximum number of leaves to evaluate in a batch.
+     * @param network The network to evaluate the leaves with.
+     * @param uWeight The weight of the U value in the selection compared to the Q value.
+     * @param numThreads The number of threads to search with.
+     * @param pipelined Whether to overlap the selection of each batch with the evaluation of the last.
+     * @param stopEarly Whether to stop once the most visited child can no longer be overtaken.
+     * @param deadline The time by which to stop searching.
+     * @param stopSignal A flag to stop searching once raised, or nullptr.
+     *
+     * @returns The number of traversals actually performed, which may overshoot
+     * `numTraversals` by up to a batch per thread, or fall short if stopped early or on time.
+    */
+    int search(int numTraversals, int maxBatchSize, int maxQueueSize,
+               INetwork<State, ACTION_SIZE>* network, float uWeight = 1.0f, int numThreads = 1,
+               bool pipelined = false, bool stopEarly = false,
+               std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+               const std::atomic<bool>* stopSignal = nullptr) {
+
+        std::atomic<int> traversals { 0 };
+        std::atomic<bool> decided { false };
+
+        // Whether to start another batch, checked by every thread between batches.
+        auto keepSearching = [&]() {
+            int remaining = numTraversals - traversals.load(std::memory_order_relaxed);
+
+            if (remaining <= 0 || decided.load(std::memory_order_relaxed)) {
+                return false;
+            }
+
+            if (stopSignal != nullptr && stopSignal->load(std::memory_order_relaxed)) {
+                return false;
+            }
+
+            if (stopEarly && isBestActionDecided(remaining)) {
+                decided.store(true, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (deadline != std::chrono::steady_clock::time_point::max()
+                && std::chrono::steady_clock::now() >= deadline && getTopTwoVisits().first > 0.0f) {
+
+                decided.store(true, std::memory_order_relaxed);
+                return false;
+            }
+
+            return true;
+        };
+
+        // The traversal and queue limits of the next batch, as tuned if there is a tuner.
+        auto batchLimits = [&]() -> std::pair<int, int> {
+            if (m_batchSizeTuner == nullptr) {
+                return { maxBatchSize, maxQueueSize };
+            }
+
+            int queueSize = m_batchSizeTuner->getQueueSize();
+            return { std::max(1, queueSize * maxBatchSize / maxQueueSize), queueSize };
+        };
+
+        // Every thread reuses its own batch buffers, from one search to the next.
+        if (m_searchScratch.size() < static_cast<size_t>(std::max(numThreads, 1))) {
+            m_searchScratch.resize(std::max(numThreads, 1));
+        }
+
+        auto searchLoop = [&](int threadIdx) {
+            PendingBatch& batch = m_searchScratch[threadIdx].m_batches[0];
+
+            while (keepSearching()) {
+                auto batchStart = std::chrono::steady_clock::now();
+
+                auto [batchSize, queueSize] = batchLimits();
+                int trav = selectLeaves(batchSize, queueSize, uWeight, batch.m_leaves, batch.m_paths);
+
+                int numLeaves = batch.m_leaves.size();
+                int numUniqueLeaves = 0;
+                double evalSeconds = 0.0;
+
+                if (numLeaves > 0) {
+                    prepareBatch(batch, queueSize);
+
+                    auto evalStart = std::chrono::steady_clock::now();
+                    NetworkOutputs outputs = evaluateBatch(batch, network);
+                    evalSeconds = secondsSince(evalStart);
+
+                    applyBatch(batch, outputs);
+                    numUniqueLeaves = batch.m_uniqueLeaves.size() - batch.m_numSpeculative;
+                }
+
+                traversals.fetch_add(trav, std::memory_order_relaxed);
+
+                // Batches that never reach the network say nothing about its efficiency.
+                if (m_batchSizeTuner != nullptr && numLeaves > 0) {
+                    m_batchSizeTuner->report(numLeaves, numUniqueLeaves, secondsSince(batchStart), evalSeconds);
+                }
+            }
+        };
+
+        auto pipelinedSearchLoop = [&](int threadIdx) {
+            // The two buffers take turns at being selected into and being in flight.
+            SearchScratch& scratch = m_searchScratch[threadIdx];
+
+            // The evaluator thread outlives the search, so that sending a batch off costs a handshake.
+            if (scratch.m_evaluator == nullptr) {
+                scratch.m_evaluator = std::make_unique<BatchEvaluator>(this);
+            }
+
+            // The batch in flight with the evaluator, if any.
+            PendingBatch* inFlight = nullptr;
+
+            while (true) {
+                bool selectMore = keepSearching();
+                if (!selectMore && inFlight == nullptr) {
+                    break;
+                }
+
+                PendingBatch* next = nullptr;
+
+                auto batchStart = std::chrono::steady_clock::now();
+
+                if (selectMore) {
+                    PendingBatch* batch = (inFlight == &scratch.m_batches[0]) ? &scratch.m_batches[1] : &scratch.m_batches[0];
+
+                    auto [batchSize, queueSize] = batchLimits();
+                    int trav = selectLeaves(batchSize, queueSize, uWeight, batch->m_leaves, batch->m_paths);
+                    traversals.fetch_add(trav, std::memory_order_relaxed);
+
+                    if (batch->m_leaves.size() > 0) {
+                        prepareBatch(*batch, queueSize);
+                        scratch.m_evaluator->start(*batch, network);
+                        next = batch;
+                    }
+                }
+
+                if (inFlight != nullptr) {
+                    // Only the wait counts as network latency, the rest is hidden behind selection.
+                    auto waitStart = std::chrono::steady_clock::now();
+                    NetworkOutputs outputs = scratch.m_evaluator->wait();
+                    double evalSeconds = secondsSince(waitStart);
+
+                    applyBatch(*inFlight, outputs);
+
+                    if (m_batchSizeTuner != nullptr) {
+                        m_batchSizeTuner->report(inFlight->m_leaves.size(),
+                                                 inFlight->m_uniqueLeaves.size() - inFlight->m_numSpeculative,
+                                                 secondsSince(batchStart), evalSeconds);
+                    }
+                }
+
+                inFlight = next;
+            }
+        };
+
+        if (numThreads <= 1) {
+            if (pipelined) {
+                pipelinedSearchLoop(0);
+            } else {
+                searchLoop(0);
+            }
+
+        } else {
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+
+            for (int i = 0; i < numThreads; ++i) {
+                if (pipelined) {
+                    threads.emplace_back(pipelinedSearchLoop, i);
+                } else {
+                    threads.emplace_back(searchLoop, i);
+                }
+            }
+
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        }
+
+        return traversals.load();
+    }
+
+    /**
+     * Searches the decision node as in Gumbel AlphaZero, to improve on the network
+     * policy even with few traversals.
+     *
+     * Rather than letting PUCT with Dirichlet noise pick among the children of the decision
+     * node, samples `numSampledActions` of them without replacement, as the top ones by
+     * network logit plus Gumbel noise. Sequential halving then splits the traversals over
+     * rounds: each round visits the remaining actions equally often, then drops the worse
+     * half by logit plus noise plus scaled Q value. Below the decision node, traversals
+     * select by PUCT as usual.
+     *
+     * The last action standing is the move to play, see `getGumbelAction`, and
+     * `getImprovedPolicy` gives the matching policy target.
+     *
+     * See `search` for the other parameters. Never stops early or on time.
+     *
+     * @param numSampledActions The most actions to sample at the decision node. Fewer are
+     * sampled if there are not enough traversals to visit each of them once per round.
+     *
+     * @returns The number of traversals performed, which may overshoot `numTraversals`
+     * by up to a batch per thread, or by a few traversals if it is tiny.
+    */
+    int searchGumbel(int numTraversals, int numSampledActions, int maxBatchSize, int maxQueueSize,
+                     INetwork<State, ACTION_SIZE>* network, float uWeight = 1.0f, int numThreads = 1,
+                     bool pipelined = false) {
+
+        assert(!m_decisionNode->m_isTerminal);
+
+        int traversals = 0;
+
+        // The logits are those of the network policy, so evaluate the decision node first.
+        refreshNode(m_decisionNode);
+        if (!m_decisionNode->m_isExpanded) {
+            traversals += search(1, 1, 1, network, uWeight);
+        }
+
+        UNode* root = m_decisionNode;
+        assert(root->m_isExpanded);
+
+        // Sample the actions by sorting the legal edges on logit plus noise.
+        int numCandidates = 0;
+        for (int edgeIdx = 0; edgeIdx < root->m_edges.size(); ++edgeIdx) {
+            if (root->m_edges.isLegal(edgeIdx, root->m_actionMask)) {
+                m_gumbelScores[edgeIdx] = policyLogit(root, edgeIdx) + GetRandom().Gumbel();
+                m_rootSchedule[numCandidates++] = edgeIdx;
+            }
+        }
+
+        auto numRoundsFor = [](int numActions) {
+            return std::max(1, static_cast<int>(std::ceil(std::log2(numActions))));
+        };
+
+        // The traversals needed to visit each action once per round, halving them after each.
+        auto minTraversalsFor = [&](int numActions) {
+            int total = 0;
+            for (int round = numRoundsFor(numActions); round > 0; --round) {
+                total += numActions;
+                numActions = (numActions + 1) / 2;
+            }
+
+            return total;
+        };
+
+        // Sample no more actions than the traversals can visit once per round.
+        int budget = numTraversals - traversals;
+        int numRemaining = std::clamp(numSampledActions, 1, numCandidates);
+        while (numRemaining > 2 && minTraversalsFor(numRemaining) > budget) {
+            --numRemaining;
+        }
+
+        auto byScore = [&](int a, int b) { return m_gumbelScores[a] > m_gumbelScores[b]; };
+        std::partial_sort(m_rootSchedule.begin(), m_rootSchedule.begin() + numRemaining,
+                          m_rootSchedule.begin() + numCandidates, byScore);
+
+        int numRounds = numRoundsFor(numRemaining);
+        int roundBudget = budget / numRounds;
+
+        for (int round = 0; round < numRounds; ++round) {
+            // The last round takes whatever is left. Every action gets the same number of visits.
+            int roundTraversals = (round == numRounds - 1) ? numTraversals - traversals : roundBudget;
+            roundTraversals = std::max(roundTraversals / numRemaining, 1) * numRemaining;
+
+            // Selection at the decision node now deals out the remaining actions in turn.
+            m_rootScheduleSize = numRemaining;
+            m_rootCursor.store(0, std::memory_order_relaxed);
+
+            // Rounds are short, so batches are capped to them to keep the visits even.
+            traversals += search(roundTraversals, std::min(maxBatchSize, roundTraversals),
+                                 std::min(maxQueueSize, roundTraversals), network, uWeight, numThreads, pipelined);
+
+            m_rootScheduleSize = 0;
+
+            // Keep the better half, or just the best after the last round.
+            float maxVisits = maxChildVisits(root);
+            auto byCompletedScore = [&](int a, int b) {
+                return m_gumbelScores[a] + gumbelSigma(root->child_Q(a), maxVisits)
+                     > m_gumbelScores[b] + gumbelSigma(root->child_Q(b), maxVisits);
+            };
+
+            int numKept = (round == numRounds - 1) ? 1 : (numRemaining + 1) / 2;
+            std::partial_sort(m_rootSchedule.begin(), m_rootSchedule.begin() + numKept,
+                              m_rootSchedule.begin() + numRemaining, byCompletedScore);
+            numRemaining = numKept;
+        }
+
+        m_gumbelAction = root->m_edges.action(m_rootSchedule[0]);
+        return traversals;
+    }
+
+    /**
+     * @returns The action picked by the last `searchGumbel`.
+    */
+    ActionIdx getGumbelAction() const {
+        return m_gumbelAction;
+    }
+
+    /**
+     * The policy target of Gumbel AlphaZero: the network logits at the decision node plus
+     * scaled completed Q values, through a softmax. Visited actions complete to their Q value,
+     * and unvisited ones to a mix of the network value and the visited Q values.
+     *
+     * @returns The improved policy, indexed by action.
+     *
+     * @note Can only be applied on an active decision node, e.g. after a search.
+    */
+    GameActionDist<ACTION_SIZE> getImprovedPolicy() {
+        UNode* root = m_decisionNode;
+        assert(root->m_isExpanded);
+
+        float mixedValue = mixedValueEstimate(root);
+        float maxVisits = maxChildVisits(root);
+
+        float scores[ACTION_SIZE];
+        float maxScore = -std::numeric_limits<float>::infinity();
+
+        for (int edgeIdx = 0; edgeIdx < root->m_edges.size(); ++edgeIdx) {
+            if (root->m_edges.isLegal(edgeIdx, root->m_actionMask)) {
+                float completedQ = (root->child_N(edgeIdx) > 0.0f) ? root->child_Q(edgeIdx) : mixedValue;
+                scores[edgeIdx] = policyLogit(root, edgeIdx) + gumbelSigma(completedQ, maxVisits);
+                maxScore = std::max(maxScore, scores[edgeIdx]);
+            }
+        }
+
+        GameActionDist<ACTION_SIZE> policy {};
+        float sum = 0.0f;
+
+        for (int edgeIdx = 0; edgeIdx < root->m_edges.size(); ++edgeIdx) {
+            if (root->m_edges.isLegal(edgeIdx, root->m_actionMask)) {
+                float weight = std::exp(scores[edgeIdx] - maxScore);
+                policy[root->m_edges.action(edgeIdx)] = weight;
+                sum += weight;
+            }
+        }
+
+        return policy / sum;
+    }
+
+    /**
+     * Performs many iterations of search by repeatedly selecting leaves,
+     * applying virtual losses during downward traversals.
+     *
+     * When leaves are terminal or gray, immediately backpropagates the result.
+     * The same goes for empty leaves whose position is in the transposition table.
+     * Other empty leaves are appended to a vector for batched NN evaluation.
+     *
+     * Safe to call concurrently from multiple threads.
+     *
+     * @param maxBatchSize The maximum number of traversals to perform.
+     * @param maxQueueSize The maximum number of leaves to evaluate in a batch.
+     * @param network The network to evaluate the leaves with.
+     * @param uWeight The weight of the U value in the selection compared to the Q value.
+     *
+     * @returns This batch of empty leaves, as well as the number of leaf selections performed.
+    */
+    std::pair<std::vector<UNode*>, int> searchAndGetLeaves(
+        int maxBatchSize, int maxQueueSize, INetwork<State, ACTION_SIZE>* network, float uWeight = 1.0f) {
+
+        std::vector<UNode*> leaves;
+        std::vector<TraversalPath> paths;
+        int traversals = selectLeaves(maxBatchSize, maxQueueSize, uWeight, leaves, paths);
+
+        return { leaves, traversals };
     }
 
     /**
-     * @returns A readonly pointer to the decision node.
+     * Takes in queued leaves and evaluates them with the network, then backpropagates the results.
+     *
+     * Requires that leaves are all empty, as in the return value from searchAndGetLeaves.
+     * A leaf appearing several times is evaluated once but backed up once per appearance.
+     * The paths to the leaves were not kept, so each is backed up through the parent pointers.
+     * Safe to call concurrently from multiple threads.
+     *
+     * @param leaves The leaves to evaluate and backpropagate.
+     * @param network The network to evaluate the leaves with.
+    */
+    void evaluateAndBackpropLeaves(const std::vector<UNode*>& leaves, INetwork<State, ACTION_SIZE>* network) {
+        PendingBatch batch;
+        batch.m_leaves = leaves;
+        prepareBatch(batch);
+
+        applyBatch(batch, evaluateBatch(batch, network));
+    }
+
+    /**
+     * Advances the decision node to the child corresponding to the given action.
+     *
+     * The decision node must be non-terminal and the action must be legal.
+     *
+     * Clears all the statistics and expanded bits in the subtree,
+     * but leaves the network evaluations intact. In particular, all
+     * active nodes are turned gray.
+     *
+     * The statistics may instead be kept, to carry on from an earlier search of the
+     * subtree, e.g. when playing rather than generating training targets. The new
+     * decision node then gets no fresh Dirichlet noise.
+     *
+     * @param action The action to advance the decision node using.
+     * @param keepStatistics Whether to keep the statistics of the subtree.
+    */
+    void advanceDecision(ActionIdx action, bool keepStatistics = false) {
+        assert(!m_decisionNode->m_isTerminal);
+        assert(m_decisionNode->m_actionMask[action] > 0.0f);
+
+        // Destroy all children except for the one we are rerooting to.
+        m_decisionNode->pruneChildrenExcept(action);
+
+        // Start a new epoch, which lazily clears all edge statistics of the new subtree and
+        // turns all active nodes gray: each node is reset when the search first reaches it.
+        UNode* child = m_decisionNode->getAddChild(action, m_snapshot.get());
+
+        if (!keepStatistics) {
+            ++m_epoch;
+            refreshNode(child);
+
+            // Shared statistics are cleared along with the tree, keeping the network outputs.
+            if (m_transpositions == Transpositions::STATISTICS) {
+                m_transpositionTable->clearStatistics();
+            }
+        }
+
+        // Set the new decision node
+        m_decisionNode = child;
+        m_hasDecisionPolicy = false;
+    }
+
+    /**
+     * Saves the subtree below the decision node to a snapshot file, see `TreeSnapshot.hpp`,
+     * so that a later tree can load it instead of searching the position again.
+     *
+     * Saves every node in the subtree, with its network outputs and proof. Edge statistics
+     * are only saved where they are in use, i.e. not left over from before a reset in
+     * `advanceDecision`, since search would reset them anyway.
+     *
+     * @param path The path of the file to write.
+     *
+     * @returns Whether the file was written.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    bool saveSnapshot(const std::string& path) const {
+        SnapshotHeader header {};
+        header.m_actionSize = ACTION_SIZE;
+        header.m_sparseEdges = UseSparseUCTEdges<ImplNode>::value;
+        header.m_rootNumVisits = m_decisionNode->N();
+        header.m_rootTotalValue = m_decisionNode->W();
+
+        // Number the nodes breadth-first, as they are reached through their parents.
+        std::vector<const UNode*> order { m_decisionNode };
+        std::vector<SnapshotNode> nodes;
+        std::vector<SnapshotEdge> edges;
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            const UNode* node = order[i];
+
+            bool isExpanded = node->m_isExpanded && node->m_epoch.load() == m_epoch;
+
+            SnapshotNode record {};
+            record.m_firstEdge = edges.size();
+            record.m_networkValue = node->m_networkValue;
+            record.m_isNetworkEvaluated = node->m_isNetworkEvaluated;
+            record.m_isExpanded = isExpanded;
+            record.m_proof = static_cast<uint8_t>(node->getProof());
+
+            for (int edgeIdx = 0; !node->m_isTerminal && edgeIdx < node->m_edges.size(); ++edgeIdx) {
+                SnapshotEdge edge {};
+                edge.m_child = -1;
+                edge.m_policy = (node == m_decisionNode && m_hasDecisionPolicy)
+                    ? m_decisionPolicy[node->m_edges.action(edgeIdx)]
+                    : node->m_edges.policy(edgeIdx);
+
+                if (const UNode* child = node->m_edges.child(edgeIdx).get(); child != nullptr) {
+                    edge.m_child = order.size();
+                    order.push_back(child);
+                }
+
+                if (isExpanded) {
+                    edge.m_prior = node->m_edges.prior(edgeIdx);
+                    edge.m_totalValue = node->child_W(edgeIdx);
+                    edge.m_numVisits = node->child_N(edgeIdx);
+                }
+
+                edges.push_back(edge);
+            }
+
+            record.m_numEdges = edges.size() - record.m_firstEdge;
+            nodes.push_back(record);
+        }
+
+        return TreeSnapshot::write(path, header, getDecisionPath(), nodes, edges);
+    }
+
+    /**
+     * Loads a snapshot file saved by `saveSnapshot` into the decision node, as a warm
+     * start for search. The file is memory-mapped rather than read, and nodes are only
+     * restored from it as search first reaches them, game nodes included, which are
+     * rebuilt by playing the actions along the way. Opening the file is all it costs upfront.
+     *
+     * The saved node must be the decision node, or below it, in which case the decision
+     * node is advanced to it first, keeping the statistics. Either way, the decision node
+     * must not have been searched yet. The statistics restored count as current, as if the
+     * search that made them had just run in this tree.
+     *
+     * @param path The path of the file to load.
+     *
+     * @returns Whether the snapshot was loaded. If not, the tree is left untouched, unless
+     * an action on the way to the saved node turned out to be illegal or the record of the
+     * saved node did not fit it.
+     *
+     * @note Not safe to call concurrently with search.
+    */
+    bool loadSnapshot(const std::string& path) {
+        std::unique_ptr<TreeSnapshot> snapshot = TreeSnapshot::open(path, ACTION_SIZE, UseSparseUCTEdges<ImplNode>::value);
+        if (snapshot == nullptr || m_decisionNode->m_isNetworkEvaluated) {
+            return false;
+        }
+
+        const SnapshotHeader& header = snapshot->header();
+        std::vector<ActionIdx> decisionPath = getDecisionPath();
+
+        if (decisionPath.size() > header.m_pathLength) {
+            return false;
+        }
+
+        for (int step = 0; step < static_cast<int>(header.m_pathLength); ++step) {
+            ActionIdx action = snapshot->pathAction(step);
+
+            if (action < 0 || action >= ACTION_SIZE
+                || (step < static_cast<int>(decisionPath.size()) && action != decisionPath[step])) {
+                return false;
+            }
+        }
+
+        // Nodes restored from an earlier snapshot must not restore their new children from it.
+        m_snapshot = nullptr;
+
+        for (int step = decisionPath.size(); step < static_cast<int>(header.m_pathLength); ++step) {
+            ActionIdx action = snapshot->pathAction(step);
+
+            if (m_decisionNode->m_isTerminal || m_decisionNode->m_actionMask[action] == 0.0f) {
+                return false;
+            }
+
+            advanceDecision(action, true);
+        }
+
+        // The rest of the tree is restored lazily, from the children of the decision node down.
+        snapshot->setEpoch(m_epoch);
+        if (!m_decisionNode->restore(*snapshot, 0)) {
+            return false;
+        }
+
+        // The saved policy is the clean one even where the priors restored carry noise.
+        m_hasDecisionPolicy = m_decisionNode->m_isNetworkEvaluated;
+        for (int edgeIdx = 0; m_hasDecisionPolicy && edgeIdx < m_decisionNode->m_edges.size(); ++edgeIdx) {
+            m_decisionPolicy[m_decisionNode->m_edges.action(edgeIdx)] = snapshot->edge(0, edgeIdx).m_policy;
+        }
+
+        atomicStore(m_decisionNode->m_parentEdge.numVisits(), header.m_rootNumVisits);
+        atomicStore(m_decisionNode->m_parentEdge.totalValue(), header.m_rootTotalValue);
+
+        m_snapshot = std::move(snapshot);
+        return true;
+    }
+
+private:
+    using NetworkOutputs = std::vector<std::pair<GameActionDist<ACTION_SIZE>, Value>>;
+
+    /// Deepest traversal whose path is recorded; deeper ones are backed up through the parent pointers.
+    static constexpr int MAX_PATH_LENGTH = 128;
+
+    /// Most nodes to walk per slot when looking for speculative leaves, bounding the cost of a fill.
+    static constexpr int SPECULATIVE_WALK_PER_SLOT = 8;
+
+    /**
+     * The nodes along one traversal, from the decision node down to the leaf,
+     * recorded by `selectLeaf` so that backup can walk an array instead of parent pointers.
+    */
+    struct TraversalPath {
+        std::array<UNode*, MAX_PATH_LENGTH> m_nodes;  // The first `m_length` nodes of the path, if it fits.
+        int m_length { 0 };                           // Length of the whole path, even if it does not fit.
+
+        void clear() {
+            m_length = 0;
+        }
+
+        void push(UNode* node) {
+            if (m_length < MAX_PATH_LENGTH) {
+                m_nodes[m_length] = node;
+            }
+
+            ++m_length;
+        }
+
+        /**
+         * @returns Whether the whole path was recorded.
+        */
+        bool fits() const {
+            return m_length <= MAX_PATH_LENGTH;
+        }
+    };
+
+    /**
+     * A child that speculative filling may evaluate, scored by the visits it can expect.
+    */
+    struct SpeculativeCandidate {
+        float m_expectedVisits;
+        UNode* m_parent;
+        int m_edgeIdx;
+    };
+
+    /**
+     * A batch of leaves on its way through the network. Reused from batch to batch,
+     * so that once the vectors have grown to the batch size, search stops allocating.
+    */
+    struct PendingBatch {
+        std::vector<UNode*> m_leaves;        // Every selection, so possibly with repeats.
+        std::vector<TraversalPath> m_paths;  // Path to each selection, if recorded; may hold spares beyond.
+        std::vector<int> m_backupOrder;      // Selections sorted by path, for merging their backups.
+        std::vector<UNode*> m_uniqueLeaves;  // The leaves to evaluate, each once, speculative ones last.
+        int m_numSpeculative { 0 };          // Trailing unique leaves only to evaluate, not to back up.
+
+        std::vector<std::pair<float, UNode*>> m_frontier;         // Nodes to speculate below, by visits.
+        std::vector<SpeculativeCandidate> m_speculativeCandidates;  // Children to speculate on.
+
+        std::vector<State> m_states;                     // Network inputs, one per unique leaf.
+        std::vector<GameActionDist<ACTION_SIZE>> m_masks;  // Action masks, one per unique leaf.
+        std::vector<SymmetryIdx> m_symmetries;           // Symmetry applied to each input.
+    };
+
+    /**
+     * A long-lived thread that evaluates the batches of one pipelined search thread, in the
+     * order they are started, with up to two in flight. Handing a batch over is a handshake on
+     * a mutex and condition variable, so unlike a thread per batch, it neither spawns nor allocates.
+    */
+    class BatchEvaluator {
+    public:
+        explicit BatchEvaluator(UCTTree* tree)
+            : m_tree { tree }, m_thread { [this] { run(); } } {}
+
+        BatchEvaluator(const BatchEvaluator&) = delete;
+        BatchEvaluator& operator=(const BatchEvaluator&) = delete;
+
+        ~BatchEvaluator() {
+            {
+                std::lock_guard<std::mutex> guard { m_mutex };
+                m_stop = true;
+            }
+
+            m_wake.notify_all();
+            m_thread.join();
+        }
+
+        /**
+         * Queues a batch for evaluation, serialized with all other calls into the network
+         * unless it is thread-safe.
+         *
+         * @note The batch must be left untouched until `wait` has returned its outputs.
+        */
+        void start(const PendingBatch& batch, INetwork<State, ACTION_SIZE>* network) {
+            {
+                std::lock_guard<std::mutex> guard { m_mutex };
+                assert(m_numStarted - m_numWaited < MAX_IN_FLIGHT);
+
+                Slot& slot = m_slots[m_numStarted % MAX_IN_FLIGHT];
+                slot.m_batch = &batch;
+                slot.m_network = network;
+                ++m_numStarted;
+            }
+
+            m_wake.notify_all();
+        }
+
+        /**
+         * Waits for the oldest batch started and not yet waited for, rethrowing anything the network threw.
+         *
+         * @returns The network outputs, one per unique leaf of the batch.
+        */
+        NetworkOutputs wait() {
+            std::unique_lock<std::mutex> lock { m_mutex };
+            assert(m_numWaited < m_numStarted);
+
+            m_wake.wait(lock, [this] { return m_numEvaluated > m_numWaited; });
+            Slot& slot = m_slots[m_numWaited++ % MAX_IN_FLIGHT];
+
+            if (slot.m_error != nullptr) {
+                std::rethrow_exception(std::exchange(slot.m_error, nullptr));
+            }
+
+            return std::move(slot.m_outputs);
+        }
+
+    private:
+        static constexpr uint64_t MAX_IN_FLIGHT = 2;
+
+        struct Slot {
+            const PendingBatch* m_batch { nullptr };
+            INetwork<State, ACTION_SIZE>* m_network { nullptr };
+            NetworkOutputs m_outputs;
+            std::exception_ptr m_error;
+        };
+
+        void run() {
+            std::unique_lock<std::mutex> lock { m_mutex };
+
+            while (true) {
+                m_wake.wait(lock, [this] { return m_numEvaluated < m_numStarted || m_stop; });
+
+                if (m_stop) {
+                    return;
+                }
+
+                // The slot is not touched by anyone else until it has been evaluated.
+                Slot& slot = m_slots[m_numEvaluated % MAX_IN_FLIGHT];
+                lock.unlock();
+
+                try {
+                    slot.m_outputs = m_tree->evaluateBatch(*slot.m_batch, slot.m_network);
+                } catch (...) {
+                    slot.m_error = std::current_exception();
+                }
+
+                lock.lock();
+                ++m_numEvaluated;
+                m_wake.notify_all();
+            }
+        }
+
+        UCTTree* m_tree;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;  // Signals batches or stop to the thread, and outputs back.
+
+        Slot m_slots[MAX_IN_FLIGHT];
+        uint64_t m_numStarted { 0 };    // Batches started, the next one going into slot `m_numStarted % MAX_IN_FLIGHT`.
+        uint64_t m_numEvaluated { 0 };  // Batches evaluated, always in the order started.
+        uint64_t m_numWaited { 0 };     // Batches whose outputs have been handed back.
+        bool m_stop { false };
+
+        std::thread m_thread;  // Last, so that it starts once everything else is initialized.
+    };
+
+    /**
+     * The batches of one search thread, two so that pipelined search can select one
+     * while the other is in flight, and the thread to evaluate them on in pipelined search.
     */
-    const UNode* getDecisionNode() {
-        return m_decisionNode;
-    }
+    struct SearchScratch {
+        PendingBatch m_batches[2];
+        std::unique_ptr<BatchEvaluator> m_evaluator;  // Created by the first pipelined search.
+    };
 
     /**
-     * Performs many iterations of search by repeatedly selecting leaves,
-     * applying virtual losses during downward traversals.
-     * 
-     * When leaves are terminal or gray, immediately backpropagates the result.
-     * When leaves are empty, appends them to a vector for batched NN evaluation.
-     * 
-     * @param maxBatchSize The maximum number of traversals to perform.
-     * @param maxQueueSize The maximum number of leaves to evaluate in a batch.
-     * @param network The network to evaluate the leaves with.
-     * @param uWeight The weight of the U value in the selection compared to the Q value.
-     * 
-     * @returns This batch of empty leaves, as well as the number of leaf selections performed.
+     * @returns The actions from the root of the game to the decision node.
     */
-    std::pair<std::vector<UNode*>, int> searchAndGetLeaves(
-        int maxBatchSize, int maxQueueSize, INetwork<State, ACTION_SIZE>* network, float uWeight = 1.0f) {
+    std::vector<ActionIdx> getDecisionPath() const {
+        std::vector<ActionIdx> actions;
+        for (const UNode* node = m_decisionNode; node->m_parent != nullptr; node = node->m_parent) {
+            actions.push_back(node->m_action);
+        }
 
-        std::vector<UNode*> leaves;
+        std::reverse(actions.begin(), actions.end());
+        return actions;
+    }
+
+    /**
+     * Selects a batch of leaves, as in `searchAndGetLeaves`, but into reused vectors.
+     *
+     * @param leaves Cleared, then filled with the empty leaves to evaluate.
+     * @param paths Filled with the path to each of the leaves, at the same index,
+     * and grown if need be. Entries beyond the leaves are scratch space.
+     *
+     * @returns The number of leaf selections performed.
+    */
+    int selectLeaves(int maxBatchSize, int maxQueueSize, float uWeight,
+                     std::vector<UNode*>& leaves, std::vector<TraversalPath>& paths) {
+        leaves.clear();
 
         int traversals = 0;
         while (traversals < maxBatchSize) {
             ++traversals;
+
+            // Select into the slot after the queued leaves, which is kept if the leaf is queued too.
+            if (paths.size() <= leaves.size()) {
+                paths.emplace_back();
+            }
+
+            TraversalPath& path = paths[leaves.size()];
             
-            UNode* leaf = selectLeaf(uWeight);  // Must be terminal, empty, or gray.
+            std::optional<Value> sharedValue;
+            UNode* leaf = selectLeaf(uWeight, sharedValue, path);  // Must be terminal, empty, or gray, unless cut off.
+
+            if (sharedValue.has_value()) {
+                // Cutoff: back up the value shared by the transposed positions,
+                // or the network value of an active node the node budget stops at.
+                backup(leaf, path, *sharedValue);
+                continue;
 
-            if (leaf->m_isTerminal) {
+            } else if (leaf->m_isTerminal) {
                 // Terminal case: compute the exact value and backpropagate immediately.
                 std::array<Value, 2> rewards = leaf->getRewards();
                 Value value = rewards[static_cast<int>(leaf->getPlayer())];
 
-                backup(leaf, value);
+                if (m_solver) {
+                    propagateProofs(leaf);
+                }
+
+                backup(leaf, path, value);
+                continue;
+
+            } else if (m_solver && leaf != m_decisionNode && leaf->isProven()) {
+                // Solved case: the exact value is known, so back it up like a terminal's.
+                backup(leaf, path, leaf->provenValue());
                 continue;
 
             } else if (leaf->m_isNetworkEvaluated) {
                 // Gray case: expand the node to active and backpropagate the network value estimate.
-                leaf->expand(m_addNoise && (leaf == m_decisionNode));  // Only add noise if decision node.
+                expandLeaf(leaf);
 
-                backup(leaf, leaf->m_networkValue);
+                backup(leaf, path, leaf->m_networkValue);
+                continue;
+
+            } else if (lookupTransposition(leaf)) {
+                // Empty case, but a transposition has already been evaluated: same as the gray case.
+                expandLeaf(leaf);
+
+                backup(leaf, path, leaf->m_networkValue);
                 continue;
 
             } else {
@@ -110,49 +1031,203 @@ public:
             }
         }
 
-        return { leaves, traversals };
+        return traversals;
     }
 
     /**
-     * Takes in queued leaves and evaluates them with the network, then backpropagates the results.
-     * 
-     * Requires that leaves are all empty, as in the return value from searchAndGetLeaves.
-     * 
-     * @param leaves The leaves to evaluate and backpropagate.
-     * @param network The network to evaluate the leaves with.
+     * Assembles the network inputs for a batch of empty leaves, overwriting
+     * those of the last batch held in the same buffers.
+     *
+     * The same leaf may have been selected several times in the batch, e.g. while the tree
+     * is still small. It is only evaluated once, but backed up once per selection.
+     *
+     * With speculative filling on, a batch short of the queue size is topped up,
+     * see `addSpeculativeLeaves`.
+     *
+     * @param batch The batch, with its leaves as selected by `selectLeaves`.
+     * @param queueSize The number of leaves to fill the batch up to, if filling speculatively.
     */
-    void evaluateAndBackpropLeaves(const std::vector<UNode*>& leaves, INetwork<State, ACTION_SIZE>* network) {
-        int numLeaves = leaves.size();
+    void prepareBatch(PendingBatch& batch, int queueSize = 0) {
+        assert(batch.m_leaves.size() > 0);
 
-        assert(numLeaves > 0);
+        batch.m_uniqueLeaves.clear();
+        batch.m_numSpeculative = 0;
+        batch.m_states.clear();
+        batch.m_masks.clear();
 
-        // Assemble a vector of states and masks for input into the NN.
-        std::vector<State> states;
-        std::vector<GameActionDist<ACTION_SIZE>> masks;
+        // Batches are small, so a linear scan beats hashing here.
+        for (UNode* leaf : batch.m_leaves) {
+            if (std::find(batch.m_uniqueLeaves.begin(), batch.m_uniqueLeaves.end(), leaf) == batch.m_uniqueLeaves.end()) {
+                batch.m_uniqueLeaves.push_back(leaf);
+            }
+        }
+
+        if (m_speculativeFill) {
+            addSpeculativeLeaves(batch, queueSize);
+        }
 
-        states.reserve(numLeaves);
-        masks.reserve(numLeaves);
+        int numLeaves = batch.m_uniqueLeaves.size();
 
+        // Assemble a vector of states and masks for input into the NN.
         for (int i = 0; i < numLeaves; ++i) {
-            states.push_back(leaves[i]->getGameState());
-            masks.push_back(leaves[i]->m_actionMask);
+            batch.m_states.push_back(batch.m_uniqueLeaves[i]->getGameState());
+            batch.m_masks.push_back(batch.m_uniqueLeaves[i]->m_actionMask);
         }
 
         // Generate symmetrizations for the states, if necessary.
-        std::vector<SymmetryIdx> symmetries(numLeaves, 0);
+        batch.m_symmetries.assign(numLeaves, 0);
         if (m_symmetrizer != nullptr) {
             int numSymmetries = m_symmetrizer->numSymmetries();
             for (int i = 0; i < numLeaves; ++i) {
-                symmetries[i] = static_cast<SymmetryIdx>(GetRandom().UniformInt(0, numSymmetries - 1));
-                states[i] = m_symmetrizer->symmetrizeState(states[i], { symmetries[i] })[0];
+                batch.m_symmetries[i] = static_cast<SymmetryIdx>(GetRandom().UniformInt(0, numSymmetries - 1));
+                batch.m_states[i] = m_symmetrizer->symmetrizeSingleState(batch.m_states[i], batch.m_symmetries[i]);
+            }
+        }
+    }
+
+    /**
+     * Appends speculative leaves to the unique leaves of a batch, up to the queue size.
+     *
+     * Walks down from the decision node, always on to the most visited active node seen
+     * so far, until there are as many candidates as slots or `SPECULATIVE_WALK_PER_SLOT`
+     * nodes per slot have been walked. The candidates are the children along their edges
+     * that are still empty, ranked by their parent's visits times their prior, i.e.
+     * roughly the visits PUCT will give them; those with the most are created
+     * (within the node budget) and appended. Candidates found in the transposition table
+     * are made gray on the spot instead.
+     *
+     * Speculative leaves get no virtual loss, so other threads may select them meanwhile;
+     * whichever evaluation lands first is kept, as for any leaf queued twice.
+     *
+     * @param batch The batch, with its selected unique leaves collected.
+     * @param queueSize The number of leaves to fill the batch up to.
+    */
+    void addSpeculativeLeaves(PendingBatch& batch, int queueSize) {
+        // Both vectors are bounded by the queue size, so are grown to it up front, even for
+        // full batches: only the `maxWalked` most visited nodes of the frontier can ever be
+        // walked, and the walk stops as soon as a node takes the candidates up to the slots.
+        batch.m_frontier.clear();
+        batch.m_frontier.reserve(SPECULATIVE_WALK_PER_SLOT * queueSize);
+        batch.m_speculativeCandidates.clear();
+        batch.m_speculativeCandidates.reserve(queueSize + ACTION_SIZE);
+
+        int numSlots = queueSize - batch.m_uniqueLeaves.size();
+        int maxWalked = SPECULATIVE_WALK_PER_SLOT * numSlots;
+
+        if (numSlots <= 0 || !m_decisionNode->m_isExpanded || m_decisionNode->m_isTerminal) {
+            return;  // Already full, or nothing to speculate below yet.
+        }
+
+        auto addToFrontier = [&](float numVisits, UNode* node) {
+            if (static_cast<int>(batch.m_frontier.size()) < maxWalked) {
+                batch.m_frontier.emplace_back(numVisits, node);
+                return;
+            }
+
+            auto least = std::min_element(batch.m_frontier.begin(), batch.m_frontier.end(),
+                                          [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            if (least->first < numVisits) {
+                *least = { numVisits, node };
+            }
+        };
+
+        addToFrontier(m_decisionNode->N(), m_decisionNode);
+
+        for (int numWalked = 0; numWalked < maxWalked && !batch.m_frontier.empty()
+             && static_cast<int>(batch.m_speculativeCandidates.size()) < numSlots; ++numWalked) {
+            auto most = std::max_element(batch.m_frontier.begin(), batch.m_frontier.end(),
+                                         [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            auto [numVisits, node] = *most;
+            *most = batch.m_frontier.back();
+            batch.m_frontier.pop_back();
+
+            for (int edgeIdx = 0; edgeIdx < node->m_edges.size(); ++edgeIdx) {
+                if (!node->m_edges.isLegal(edgeIdx, node->m_actionMask)) {
+                    continue;
+                }
+
+                UNode* child = node->getAddChildAt(edgeIdx, false);
+
+                if (child == nullptr || !child->m_isNetworkEvaluated) {
+                    float expectedVisits = numVisits * node->child_P(edgeIdx);
+
+                    if (expectedVisits > 0.0f && (child == nullptr || !child->m_isTerminal)) {
+                        batch.m_speculativeCandidates.push_back({ expectedVisits, node, edgeIdx });
+                    }
+
+                    continue;
+                }
+
+                refreshNode(child);
+
+                if (child->m_isExpanded && !child->m_isTerminal && !(m_solver && child->isProven())) {
+                    addToFrontier(node->child_N(edgeIdx), child);
+                }
+            }
+        }
+
+        auto& candidates = batch.m_speculativeCandidates;
+        auto numRanked = candidates.begin() + std::min<size_t>(numSlots, candidates.size());
+
+        std::partial_sort(candidates.begin(), numRanked, candidates.end(), [](const auto& a, const auto& b) {
+            return a.m_expectedVisits > b.m_expectedVisits;
+        });
+
+        for (auto candidate = candidates.begin(); candidate != numRanked; ++candidate) {
+            UNode* leaf = candidate->m_parent->getAddChildAt(
+                candidate->m_edgeIdx, mayCreateChild(candidate->m_parent), m_snapshot.get());
+
+            if (leaf == nullptr || leaf->m_isTerminal || leaf->m_isNetworkEvaluated || (m_solver && leaf->isProven())) {
+                continue;  // Out of node budget, or nothing left to evaluate.
+            }
+
+            if (std::find(batch.m_uniqueLeaves.begin(), batch.m_uniqueLeaves.end(), leaf) != batch.m_uniqueLeaves.end()) {
+                continue;  // Selected anyway.
             }
+
+            if (lookupTransposition(leaf)) {
+                continue;
+            }
+
+            batch.m_uniqueLeaves.push_back(leaf);
+            ++batch.m_numSpeculative;
         }
+    }
+
+    /**
+     * Evaluates a batch, serialized with all other calls into the network unless it is thread-safe.
+    */
+    NetworkOutputs evaluateBatch(const PendingBatch& batch, INetwork<State, ACTION_SIZE>* network) {
+        std::unique_lock<std::mutex> lock { m_networkMutex, std::defer_lock };
+        if (!network->isThreadSafe()) {
+            lock.lock();
+        }
+
+        return network->evaluate(batch.m_states, batch.m_masks);
+    }
+
+    /**
+     * @returns The seconds elapsed since the given time.
+    */
+    static double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
 
-        // Perform batched evaluation of the states.
-        std::vector<std::pair<GameActionDist<ACTION_SIZE>, Value>> outputs = network->evaluate(states, masks);
+    /**
+     * Applies the network outputs of a batch to its leaves, making them active,
+     * then backpropagates once per selection, removing each virtual loss.
+     * Speculative leaves are only made gray.
+     *
+     * @param batch The batch the outputs belong to.
+     * @param outputs The network outputs, one per unique leaf.
+    */
+    void applyBatch(PendingBatch& batch, const NetworkOutputs& outputs) {
+        int numLeaves = batch.m_uniqueLeaves.size();
 
         for (int i = 0; i < numLeaves; ++i) {
-            UNode* leaf = leaves[i];
+            UNode* leaf = batch.m_uniqueLeaves[i];
             std::pair<GameActionDist<ACTION_SIZE>, Value> output = outputs[i];
 
             GameActionDist policy = output.first;
@@ -160,145 +1235,478 @@ public:
 
             // Undo the symmetrization.
             if (m_symmetrizer != nullptr) {
-                policy = m_symmetrizer->symmetrizeActionDist(policy, { m_symmetrizer->inverseSymmetry(symmetries[i]) })[0];
+                policy = m_symmetrizer->symmetrizeSingleActionDist(policy, m_symmetrizer->inverseSymmetry(batch.m_symmetries[i]));
+            }
+
+            if (m_transpositionTable != nullptr) {
+                m_transpositionTable->store(leaf->m_hash, policy, value);
             }
 
-            // Note that the same leaf could occur multiple times in the output.
-            // We cannot easily remove duplicates since we still need to remove the virtual losses,
-            // but code could be written to optimize this by not passing them all into the 
-            // network and instead backing up directly.
+            {
+                // Another thread may be finishing the same leaf concurrently.
+                std::lock_guard<SpinLock> guard { leaf->m_lock };
 
-            if (!leaf->m_isNetworkEvaluated) {
-                // Update the cached network values, making the leaf gray.
-                leaf->addNetworkOutput(policy, value);
+                if (!leaf->m_isNetworkEvaluated) {
+                    // Update the cached network values, making the leaf gray.
+                    leaf->addNetworkOutput(policy, value);
+                }
             }
 
-            if (!leaf->m_isExpanded) {
-                // Expand the node, making the leaf active.
-                leaf->expand(m_addNoise && (leaf == m_decisionNode));  // Only add noise if decision node.
+            if (i >= numLeaves - batch.m_numSpeculative) {
+                continue;  // Speculative: left gray for a traversal to expand.
+            }
+
+            // Expand the node, making the leaf active.
+            expandLeaf(leaf);
+        }
+
+        // Backpropagate the network value estimate once per selection, removing each virtual loss.
+        if (batch.m_paths.size() >= batch.m_leaves.size()) {
+            backupBatch(batch);
+        } else {
+            for (UNode* leaf : batch.m_leaves) {
+                backup(leaf, leaf->m_networkValue);
             }
-            
-            // Backpropagate the network value estimate.
-            backup(leaf, leaf->m_networkValue);
         }
     }
 
     /**
-     * Advances the decision node to the child corresponding to the given action.
-     * 
-     * The decision node must be non-terminal and the action must be legal.
-     * 
-     * Clears all the statistics and expanded bits in the subtree,
-     * but leaves the network evaluations intact. In particular, all
-     * active nodes are turned gray.
-     * 
-     * @param action The action to advance the decision node using.
+     * Backs up the network value of every selection in a batch, as `backup` would one by one,
+     * but updating each node shared by several of the paths only once.
+     *
+     * The paths all start at the decision node, so sorted by their nodes, those sharing a
+     * prefix come out next to each other. A single sweep then keeps a stack of the current
+     * path, adding each selection to the bottom of its path and folding the sums of a node
+     * into its parent as it is popped, at which point its edge is updated.
+     *
+     * @param batch The batch, whose leaves have been evaluated and have paths recorded.
     */
-    void advanceDecision(ActionIdx action) {
-        assert(!m_decisionNode->m_isTerminal);
-        assert(m_decisionNode->m_actionMask[action] > 0.0f);
+    void backupBatch(PendingBatch& batch) {
+        int numLeaves = batch.m_leaves.size();
 
-        // Destroy all children except for the one we are rerooting to.
-        m_decisionNode->pruneChildrenExcept(action);
+        // Paths too deep to record are backed up on their own.
+        batch.m_backupOrder.clear();
+        for (int i = 0; i < numLeaves; ++i) {
+            if (batch.m_paths[i].fits()) {
+                batch.m_backupOrder.push_back(i);
+            } else {
+                backup(batch.m_leaves[i], batch.m_leaves[i]->m_networkValue);
+            }
+        }
 
-        // Clear all edges statistics of the new subtree, and turn all active nodes gray.
-        UNode* child = m_decisionNode->getAddChild(action);
-        clearSubtree(child);
+        auto pathBegin = [&](int i) { return batch.m_paths[i].m_nodes.begin(); };
+        auto pathEnd = [&](int i) { return batch.m_paths[i].m_nodes.begin() + batch.m_paths[i].m_length; };
 
-        // Set the new decision node
-        m_decisionNode = m_decisionNode->m_children[action].get();
+        std::sort(batch.m_backupOrder.begin(), batch.m_backupOrder.end(), [&](int a, int b) {
+            return std::lexicographical_compare(pathBegin(a), pathEnd(a), pathBegin(b), pathEnd(b), std::less<UNode*> {});
+        });
+
+        // For each node on the stack: the selections below it, and the sum of their values
+        // from the perspective of player zero, negated as in `backup`.
+        std::array<float, MAX_PATH_LENGTH> numSelections;
+        std::array<float, MAX_PATH_LENGTH> sumEstimates;
+
+        const TraversalPath* stackPath = nullptr;
+        int stackSize = 0;
+
+        // Updates the edge into the node on top of the stack, and folds its sums into its parent.
+        auto pop = [&]() {
+            --stackSize;
+            UNode* node = stackPath->m_nodes[stackSize];
+
+            float sign = (node->getPlayer() == Player::ZERO) ? 1.0f : -1.0f;
+            float edgeValue = sign * sumEstimates[stackSize];
+
+            // Extra +1 per selection due to reverting the virtual losses.
+            node->addValue(numSelections[stackSize] + edgeValue);
+
+            if (m_transpositions == Transpositions::STATISTICS) {
+                m_transpositionTable->addVisits(node->m_hash, numSelections[stackSize], -edgeValue);
+            }
+
+            if (stackSize > 0) {
+                numSelections[stackSize - 1] += numSelections[stackSize];
+                sumEstimates[stackSize - 1] += sumEstimates[stackSize];
+            }
+        };
+
+        for (int i : batch.m_backupOrder) {
+            const TraversalPath& path = batch.m_paths[i];
+            UNode* leaf = batch.m_leaves[i];
+
+            int shared = 0;
+            if (stackPath != nullptr) {
+                shared = std::mismatch(pathBegin(i), pathEnd(i),
+                                       stackPath->m_nodes.begin(), stackPath->m_nodes.begin() + stackSize).first - pathBegin(i);
+            }
+
+            while (stackSize > shared) {
+                pop();
+            }
+
+            for (; stackSize < path.m_length; ++stackSize) {
+                numSelections[stackSize] = 0.0f;
+                sumEstimates[stackSize] = 0.0f;
+            }
+
+            stackPath = &path;
+
+            numSelections[stackSize - 1] += 1.0f;
+            sumEstimates[stackSize - 1] += -leaf->m_networkValue * ((leaf->getPlayer() == Player::ZERO) ? 1.0f : -1.0f);
+        }
+
+        while (stackSize > 0) {
+            pop();
+        }
+    }
+
+    /**
+     * @param remainingTraversals The number of traversals left in the search.
+     *
+     * @returns Whether the most visited child of the decision node leads every other child
+     * by more visits than there are traversals left, so it will stay the most visited.
+    */
+    bool isBestActionDecided(int remainingTraversals) const {
+        auto [most, secondMost] = getTopTwoVisits();
+
+        return most - secondMost > remainingTraversals;
+    }
+
+    /**
+     * @returns The visit counts of the two most visited children of the decision node,
+     * or zeros while it is not expanded.
+    */
+    std::pair<float, float> getTopTwoVisits() const {
+        if (!m_decisionNode->m_isExpanded || m_decisionNode->m_isTerminal) {
+            return { 0.0f, 0.0f };  // Edges are not allocated yet.
+        }
+
+        float most = 0.0f;
+        float secondMost = 0.0f;
+
+        for (int edgeIdx = 0; edgeIdx < m_decisionNode->m_edges.size(); ++edgeIdx) {
+            float numVisits = m_decisionNode->child_N(edgeIdx);
+
+            if (numVisits > most) {
+                secondMost = most;
+                most = numVisits;
+            } else if (numVisits > secondMost) {
+                secondMost = numVisits;
+            }
+        }
+
+        return { most, secondMost };
+    }
+
+    /**
+     * @returns Whether a new child may be created below the given node within the node budget.
+     * Children of the decision node are always allowed, so that the search never
+     * stalls at the root when the subtree kept from the last move already fills the budget.
+    */
+    bool mayCreateChild(const UNode* parent) const {
+        return (m_maxNodes == 0) || (parent == m_decisionNode) || (getNumNodes() < m_maxNodes);
     }
 
-private:
     /**
      * Deterministically select the next leaf based on the best path
      * through the current active nodes from the root.
-     * 
+     *
      * Adds virtual losses while traveling down the tree, to all nodes
      * from the root to the leaf, inclusive.
-     * 
+     *
+     * With shared statistics, also stops at an active node whose transposed
+     * positions have been visited more often than the node itself, setting
+     * `sharedValue` to their average value instead of searching further.
+     *
+     * Once the tree holds `m_maxNodes` nodes, no more children are created below the
+     * decision node (see `mayCreateChild`): the search instead continues through the best
+     * existing child, and only stops at an active node that has none, setting `sharedValue`
+     * to its network value. Concurrent threads may overshoot the budget by a node each.
+     *
      * @param uWeight The weight of the U value in the selection compared to the Q value.
-     * 
+     * @param sharedValue Set to the value to back up on a cutoff.
+     * @param path Cleared, then filled with the nodes from the decision node down to the returned node.
+     *
      * @returns A pointer to a node that is terminal, empty, or gray. Must be the first
-     * such node along the path down from the root.
+     * such node along the path down from the root. On a cutoff, an active node.
+     * With the solver on, may also be the first proven node below the decision node.
     */
-    UNode* selectLeaf(float uWeight) {
+    UNode* selectLeaf(float uWeight, std::optional<Value>& sharedValue, TraversalPath& path) {
         UNode* current = m_decisionNode;
+        refreshNode(current);
+
+        path.clear();
+        path.push(current);
 
         while (current->m_isExpanded && !current->m_isTerminal) {
-            // Keep selecting down active nodes.
-            ActionIdx bestAction = current->bestAction(uWeight);
+            // Keep selecting down active nodes, except where Gumbel search dictates the root edge.
+            int bestEdge = (current == m_decisionNode && m_rootScheduleSize > 0)
+                ? m_rootSchedule[m_rootCursor.fetch_add(1, std::memory_order_relaxed) % m_rootScheduleSize]
+                : current->selectEdge(uWeight, m_solver, (current == m_decisionNode) ? 0 : m_pruneWidth);
+
+            assert(current->m_isNetworkEvaluated);
+
+            UNode* child = current->getAddChildAt(bestEdge, mayCreateChild(current), m_snapshot.get());
+
+            if (child == nullptr) {
+                // Out of node budget: carry on through the best child that already exists,
+                // so that visits keep spreading over the tree instead of piling onto one edge.
+                bestEdge = current->selectExistingEdge(uWeight, m_solver);
+                child = (bestEdge < 0) ? nullptr : current->getAddChildAt(bestEdge, false, m_snapshot.get());
+            }
+
+            if (child == nullptr) {
+                // No child at all: evaluate this node again instead of growing the tree.
+                sharedValue = current->m_networkValue;
+                break;
+            }
 
             // Record a virtual loss to discount retracing the same path again.
-            current->N()++;
-            current->W()--;
+            current->addVirtualLoss();
 
-            assert(current->m_isNetworkEvaluated);
+            current = child;
+            refreshNode(current);
+            path.push(current);
 
-            current = current->getAddChild(bestAction);
+            if (m_solver && current->isProven()) {
+                break;  // Solved: no need to search any deeper.
+            }
+
+            if (m_transpositions == Transpositions::STATISTICS && current->m_isExpanded && !current->m_isTerminal) {
+                float totalValue, numVisits;
+                m_transpositionTable->getStatistics(current->m_hash, totalValue, numVisits);
+
+                // The table counts the visits through this node too, so compare the rest against them.
+                if (numVisits - current->N() > current->N()) {
+                    sharedValue = totalValue / numVisits;
+                    break;
+                }
+            }
         }
 
         // Record a virtual loss to discount retracing the same path again.
-        current->N()++;
-        current->W()--;
+        current->addVirtualLoss();
 
-        // Reached a terminal, gray, or empty node.
-        assert(current->m_isTerminal || !current->m_isExpanded);
+        // Reached a terminal, gray, or empty node. Under tree-parallel search,
+        // another thread may already have expanded it since we looked.
 
         return current;
     }
 
     /**
      * Propagates the value estimate of a given node back up along the path to the root.
-     * 
+     *
      * Undoes the virtual loss penalty from the node to the root, inclusive.
-     * 
-     * The node at the bottom must be terminal or active.
-     * 
+     *
+     * The node at the bottom must be terminal, proven, or active.
+     *
      * @param node The node to backpropagate from.
      * @param valueEstimate The value estimate to backpropagate.
     */
     void backup(UNode* node, float valueEstimate) {
-        assert(node->m_isTerminal || (node->m_isNetworkEvaluated && node->m_isExpanded));
+        assert(node->m_isTerminal || node->isProven() || (node->m_isNetworkEvaluated && node->m_isExpanded));
 
         // Value is negated since they are stored from the perspective of the parent.
         float estimate = -valueEstimate * ((node->getPlayer() == Player::ZERO) ? 1 : -1);
         UNode* current = node;
         while (current != m_decisionNode->m_parent) {
+            const float edgeValue = estimate * ((current->getPlayer() == Player::ZERO) ? 1 : -1);
+
             // Extra +1 due to reverting the virtual losses.
-            current->W() += 1 + estimate * ((current->getPlayer() == Player::ZERO) ? 1 : -1);
+            current->addValue(1 + edgeValue);
+
+            if (m_transpositions == Transpositions::STATISTICS) {
+                // Edge values are from the perspective of the parent, table values from the node.
+                m_transpositionTable->addVisit(current->m_hash, -edgeValue);
+            }
 
             current = current->m_parent;
         }
     }
 
     /**
-     * Clears all the nodes in the subtree of the node by resetting edge statistics,
-     * as well as setting them all to un-expanded (but keeping the network evaluation).
-     * 
-     * Turns all active nodes to gray.
-     * 
-     * @param node The node to clear the subtree of.
+     * Like `backup`, but walks the path recorded by `selectLeaf` rather than the parent pointers.
+     *
+     * @param node The node to backpropagate from, at the bottom of the path.
+     * @param path The path from the decision node down to the node.
+     * @param valueEstimate The value estimate to backpropagate.
     */
-    void clearSubtree(UNode* node) {
-        if (!node->m_isExpanded) {
+    void backup(UNode* node, const TraversalPath& path, float valueEstimate) {
+        if (!path.fits()) {
+            backup(node, valueEstimate);
             return;
         }
 
-        // Reset the edge statistics and turn off the expanded bit.
-        node->m_edgeStatistics.reset();
-        node->m_isExpanded = false;
+        assert(path.m_nodes[path.m_length - 1] == node);
+        assert(node->m_isTerminal || node->isProven() || (node->m_isNetworkEvaluated && node->m_isExpanded));
+
+        float estimate = -valueEstimate * ((node->getPlayer() == Player::ZERO) ? 1 : -1);
+        for (int depth = path.m_length - 1; depth >= 0; --depth) {
+            UNode* current = path.m_nodes[depth];
+            const float edgeValue = estimate * ((current->getPlayer() == Player::ZERO) ? 1 : -1);
+
+            // Extra +1 due to reverting the virtual losses.
+            current->addValue(1 + edgeValue);
+
+            if (m_transpositions == Transpositions::STATISTICS) {
+                m_transpositionTable->addVisit(current->m_hash, -edgeValue);
+            }
+        }
+    }
+
+    /**
+     * @returns The log of the network policy along an edge, floored to stay finite.
+    */
+    static float policyLogit(UNode* node, int edgeIdx) {
+        return std::log(std::max(node->m_edges.policy(edgeIdx), 1e-8f));
+    }
+
+    /**
+     * @returns The most visits to any child of a node.
+    */
+    static float maxChildVisits(UNode* node) {
+        float maxVisits = 0.0f;
+        for (int edgeIdx = 0; edgeIdx < node->m_edges.size(); ++edgeIdx) {
+            maxVisits = std::max(maxVisits, node->child_N(edgeIdx));
+        }
+
+        return maxVisits;
+    }
+
+    /**
+     * @returns A Q value in `[-1, 1]` scaled to be added to logits, growing with the visits
+     * as the Q values become more trustworthy.
+    */
+    static float gumbelSigma(float q, float maxVisits) {
+        return (GUMBEL_C_VISIT + maxVisits) * GUMBEL_C_SCALE * (q + 1.0f) / 2.0f;
+    }
+
+    /**
+     * @returns The value of an active node to complete unvisited children with: its network
+     * value, mixed with the policy-weighted average Q value of the visited children.
+    */
+    static float mixedValueEstimate(UNode* node) {
+        float sumVisits = 0.0f;
+        float sumPolicy = 0.0f;
+        float sumPolicyQ = 0.0f;
+
+        for (int edgeIdx = 0; edgeIdx < node->m_edges.size(); ++edgeIdx) {
+            float visits = node->child_N(edgeIdx);
+            if (visits > 0.0f) {
+                sumVisits += visits;
+                sumPolicy += node->m_edges.policy(edgeIdx);
+                sumPolicyQ += node->m_edges.policy(edgeIdx) * node->child_Q(edgeIdx);
+            }
+        }
+
+        if (sumPolicy <= 0.0f) {
+            return node->m_networkValue;
+        }
+
+        return (node->m_networkValue + sumVisits * sumPolicyQ / sumPolicy) / (1.0f + sumVisits);
+    }
+
+    /**
+     * Proves the ancestors of a newly proven node whose values follow from it,
+     * up to and including the decision node. Stops at the first ancestor
+     * that stays unproven, or that another thread has proven already.
+     *
+     * @param node The proven node.
+    */
+    void propagateProofs(UNode* node) {
+        for (UNode* current = node->m_parent; current != m_decisionNode->m_parent; current = current->m_parent) {
+            if (!current->setProof(current->deduceProof())) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Looks up an empty leaf in the transposition table, caching the network output if found.
+     *
+     * @returns Whether the leaf was found, in which case it is now gray.
+    */
+    bool lookupTransposition(UNode* leaf) {
+        if (m_transpositionTable == nullptr) {
+            return false;
+        }
+
+        GameActionDist<ACTION_SIZE> policy;
+        Value value;
+
+        if (!m_transpositionTable->lookup(leaf->m_hash, policy, value)) {
+            return false;
+        }
+
+        std::lock_guard<SpinLock> guard { leaf->m_lock };
+
+        if (!leaf->m_isNetworkEvaluated) {
+            leaf->addNetworkOutput(policy, value);
+        }
+
+        return true;
+    }
+
+    /**
+     * Expands a gray leaf into an active one, unless another thread already did.
+     *
+     * @param leaf The leaf to expand, must be non-terminal and evaluated.
+    */
+    void expandLeaf(UNode* leaf) {
+        std::lock_guard<SpinLock> guard { leaf->m_lock };
 
-        // Recursively call on the children.
-        for (const std::unique_ptr<UNode>& child : node->m_children) {
-            if (child != nullptr) {
-                clearSubtree(child.get());
+        if (!leaf->m_isExpanded) {
+            bool addNoise = m_addNoise && (leaf == m_decisionNode);  // Only add noise if decision node.
+
+            // Under the sparse layout the noise overwrites the policy, so keep a clean copy for snapshots.
+            if (addNoise) {
+                for (int edgeIdx = 0; edgeIdx < leaf->m_edges.size(); ++edgeIdx) {
+                    m_decisionPolicy[leaf->m_edges.action(edgeIdx)] = leaf->m_edges.policy(edgeIdx);
+                }
+                m_hasDecisionPolicy = true;
             }
+
+            leaf->expand(addNoise, m_dirEps, m_dirAlpha);
+        }
+    }
+
+    /**
+     * Brings a node into the current epoch, if it was last reset in an earlier one,
+     * by resetting its edge statistics and setting it to un-expanded (but keeping
+     * the network evaluation). Turns an active node from an earlier epoch gray.
+     *
+     * Replaces an eager walk of the whole reused subtree in `advanceDecision`:
+     * nodes are only ever reached through their parent, which is refreshed first,
+     * so every node the search touches is refreshed before its statistics are used.
+     *
+     * @param node The node to refresh.
+    */
+    void refreshNode(UNode* node) {
+        if (node->m_epoch.load(std::memory_order_acquire) == m_epoch) {
+            return;
+        }
+
+        std::lock_guard<SpinLock> guard { node->m_lock };
+
+        if (node->m_epoch.load(std::memory_order_relaxed) == m_epoch) {
+            return;  // Another thread got here first.
+        }
+
+        if (node->m_isExpanded) {
+            node->m_edges.reset();
+            node->m_isExpanded = false;
         }
+
+        node->m_epoch.store(m_epoch, std::memory_order_release);
     }
 
-    /// Edge statistics of a virtual "parent" of the root, for accessing N() at the root.
-    UNode::EdgeStatistics m_edgeStatistics {};
+    /// Pools for the nodes of both trees and their edges. Declared first, so that they outlive the nodes.
+    NodePool<ImplNode> m_gameNodePool;
+    NodePool<UNode> m_uctNodePool;
+    typename UNode::Edges::Pool m_edgePool;  // Edge records of the sparse layout, or nothing under the dense one.
+
+    /// Edge from a virtual "parent" of the root, for accessing N() at the root.
+    typename UNode::Edges::RootEdge m_rootEdge {};
 
     /// A unique pointer to the root node of the game tree; we own it.
     std::unique_ptr<GameNode<ImplNode, State, ACTION_SIZE>> m_gameRoot;
@@ -309,13 +1717,49 @@ private:
     /// The current node in the tree, i.e. our decision point for the next action.
     UNode* m_decisionNode;
 
-    InitQ m_initQMethod { InitQ::PARENT };
     float m_dirAlpha {};
     float m_dirEps {};
 
     bool m_addNoise { true };
 
     ISymmetrizer<State, ACTION_SIZE>* m_symmetrizer { nullptr };
+
+    Transpositions m_transpositions { Transpositions::NONE };
+
+    /// Table of network outputs and statistics by position, if exploiting transpositions.
+    std::unique_ptr<TranspositionTable<ACTION_SIZE>> m_transpositionTable;
+
+    /// Most UCT nodes to keep in the tree, or zero for no limit.
+    size_t m_maxNodes { 0 };
+
+    /// Whether to prove nodes and steer search by the proofs.
+    bool m_solver { false };
+
+    /// Network policy of the decision node from before noise was mixed into its priors, if it was.
+    GameActionDist<ACTION_SIZE> m_decisionPolicy {};
+    bool m_hasDecisionPolicy { false };
+
+    /// The snapshot last loaded, which nodes not yet created are restored from.
+    std::unique_ptr<TreeSnapshot> m_snapshot;
+
+    /// Incremented on every `advanceDecision`; nodes stamped with an older epoch are stale.
+    uint32_t m_epoch { 0 };
+
+    BatchSizeTuner* m_batchSizeTuner { nullptr };  // Sizes the batches of search, if set.
+    bool m_speculativeFill { false };              // Whether to top up short batches with speculative leaves.
+    int m_pruneWidth { 0 };                        // Moves considered below the decision node before unpruning, zero for all.
+
+    std::vector<SearchScratch> m_searchScratch;  // Batch buffers, one set per search thread.
+
+    // Gumbel search at the decision node.
+    std::array<float, ACTION_SIZE> m_gumbelScores {};  // Logit plus Gumbel noise, by edge.
+    std::array<int, ACTION_SIZE> m_rootSchedule {};    // Sampled edges, the remaining ones first.
+    int m_rootScheduleSize { 0 };                      // Edges to deal out at the decision node, if any.
+    std::atomic<int> m_rootCursor { 0 };               // Traversals dealt out so far.
+    ActionIdx m_gumbelAction { 0 };                    // Action picked by the last Gumbel search.
+
+    /// Serializes calls into non-thread-safe networks during tree-parallel search.
+    std::mutex m_networkMutex;
 };
 
 } // namespace SPRL
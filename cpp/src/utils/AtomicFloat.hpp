@@ -0,0 +1,40 @@
+#ifndef SPRL_ATOMIC_FLOAT_HPP
+#define SPRL_ATOMIC_FLOAT_HPP
+
+/**
+ * @file AtomicFloat.hpp
+ * 
+ * Relaxed atomic operations on plain `float` storage, via `std::atomic_ref`.
+ * 
+ * Lets statistics arrays keep their ordinary layout (so that they can still be
+ * copied out as a `GameActionDist`) while being safely updated by many threads.
+*/
+
+#include <atomic>
+
+namespace SPRL {
+
+/**
+ * @returns The current value of `target`, read atomically.
+*/
+inline float atomicLoad(const float& target) {
+    return std::atomic_ref<float>(const_cast<float&>(target)).load(std::memory_order_relaxed);
+}
+
+/**
+ * Atomically overwrites `target` with `value`.
+*/
+inline void atomicStore(float& target, float value) {
+    std::atomic_ref<float>(target).store(value, std::memory_order_relaxed);
+}
+
+/**
+ * Atomically adds `delta` to `target`.
+*/
+inline void atomicAdd(float& target, float delta) {
+    std::atomic_ref<float>(target).fetch_add(delta, std::memory_order_relaxed);
+}
+
+} // namespace SPRL
+
+#endif
@@ -0,0 +1,460 @@
+#ifndef SPRL_NODE_POOL_HPP
+#define SPRL_NODE_POOL_HPP
+
+/**
+ * @file NodePool.hpp
+ *
+ * Slab allocators for tree nodes of a single type and for the arrays they own,
+ * so that expanding and pruning trees does not go through `malloc` and `free` per node.
+*/
+
+#include "SpinLock.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace SPRL {
+
+/// Size of a transparent huge page on x86-64 Linux.
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * The slabs that a pool carves its slots out of. Slabs are only ever
+ * returned to the system in bulk, when the arena itself is destroyed.
+ *
+ * Not thread-safe: the pool owning the arena serializes access to it.
+*/
+class SlabArena {
+public:
+    /**
+     * @param useHugePages Whether to back slabs with transparent huge pages where
+     *                     available, to cut TLB misses when walking large trees.
+     * @param alignment The alignment of the slots carved out of the slabs.
+    */
+    SlabArena(bool useHugePages, size_t alignment)
+        : m_useHugePages { useHugePages },
+          m_slabBytes { useHugePages ? HUGE_PAGE_SIZE : DEFAULT_SLAB_BYTES },
+          m_alignment { alignment } {
+    }
+
+    ~SlabArena() {
+        for (void* slab : m_slabs) {
+            freeSlab(slab);
+        }
+    }
+
+    SlabArena(const SlabArena&) = delete;
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    /**
+     * @returns The size to carve slabs up in, in bytes.
+    */
+    size_t slabBytes() const {
+        return m_slabBytes;
+    }
+
+    /**
+     * Reserves a new slab from the system.
+     *
+     * @param bytes The size of the slab, rounded up to whole huge pages if using them.
+     *
+     * @returns A pointer to the start of the slab.
+    */
+    void* allocateSlab(size_t bytes) {
+        m_slabs.reserve(m_slabs.size() + 1);  // So that recording the slab cannot throw and leak it.
+
+        if (m_useHugePages) {
+            bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+            void* slab = std::aligned_alloc(HUGE_PAGE_SIZE, bytes);
+            if (slab == nullptr) {
+                throw std::bad_alloc {};
+            }
+
+#ifdef MADV_HUGEPAGE
+            // Only a hint; the kernel falls back to regular pages if it must.
+            madvise(slab, bytes, MADV_HUGEPAGE);
+#endif
+
+            m_slabs.push_back(slab);
+            m_bytesReserved += bytes;
+            return slab;
+        }
+
+        void* slab = ::operator new(bytes, std::align_val_t { m_alignment });
+
+        m_slabs.push_back(slab);
+        m_bytesReserved += bytes;
+        return slab;
+    }
+
+    /**
+     * @returns The number of bytes of slabs reserved from the system.
+    */
+    size_t bytesReserved() const {
+        return m_bytesReserved;
+    }
+
+private:
+    /// Default slab size when not using huge pages.
+    static constexpr size_t DEFAULT_SLAB_BYTES = 256 * 1024;
+
+    void freeSlab(void* slab) {
+        if (m_useHugePages) {
+            std::free(slab);
+        } else {
+            ::operator delete(slab, std::align_val_t { m_alignment });
+        }
+    }
+
+    bool m_useHugePages;
+    size_t m_slabBytes;
+    size_t m_alignment;
+
+    std::vector<void*> m_slabs {};  // All slabs, freed in bulk on destruction.
+    size_t m_bytesReserved { 0 };
+};
+
+/**
+ * Pool of fixed-size slots for objects of type `T`, carved out of large slabs.
+ *
+ * Allocation pops a free slot (or bumps a pointer into the newest slab), and
+ * destruction pushes the slot back onto the free list, both in O(1). Slabs are
+ * only ever returned to the system in bulk, when the pool itself is destroyed,
+ * so all objects must be destroyed before their pool.
+ *
+ * Thread-safe, so that tree-parallel search can create nodes concurrently.
+ *
+ * @tparam T The type of object held in the pool.
+*/
+template <typename T>
+class NodePool {
+public:
+    /**
+     * Constructs an empty pool. No memory is reserved until the first allocation.
+     *
+     * @param useHugePages Whether to back slabs with transparent huge pages where
+     *                     available, to cut TLB misses when walking large trees.
+    */
+    explicit NodePool(bool useHugePages = false)
+        : m_slabs { useHugePages, alignof(Slot) } {
+    }
+
+    ~NodePool() {
+        assert(m_numLive == 0);
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    /**
+     * Constructs a new object in a slot of the pool.
+     *
+     * @param args The arguments forwarded to the constructor of `T`.
+     *
+     * @returns A raw pointer to the new object, to be released with `destroy`.
+    */
+    template <typename... Args>
+    T* create(Args&&... args) {
+        void* slot = allocateSlot();
+
+        T* ptr;
+        try {
+            ptr = new (slot) T(std::forward<Args>(args)...);
+
+        } catch (...) {
+            freeSlot(slot);
+            throw;
+        }
+
+        if constexpr (REPORTS_HEAP_BYTES) {
+            m_heapBytes.fetch_add(ptr->heapBytes(), std::memory_order_relaxed);
+        }
+
+        return ptr;
+    }
+
+    /**
+     * Destroys an object created by this pool and recycles its slot.
+    */
+    void destroy(T* ptr) {
+        if constexpr (REPORTS_HEAP_BYTES) {
+            m_heapBytes.fetch_sub(ptr->heapBytes(), std::memory_order_relaxed);
+        }
+
+        ptr->~T();
+        freeSlot(ptr);
+    }
+
+    /**
+     * @returns The number of objects currently alive in the pool.
+     * May be read while other threads allocate.
+    */
+    size_t numLive() const {
+        return m_numLive.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @returns The number of bytes taken up by the objects currently alive in the pool,
+     * not counting any heap memory that they own.
+    */
+    size_t bytesInUse() const {
+        return numLive() * sizeof(Slot);
+    }
+
+    /**
+     * @returns The number of bytes that the objects currently alive in the pool hold on the heap,
+     * if `T` reports them through `heapBytes()`, else zero. May be read while other threads allocate.
+    */
+    size_t heapBytesInUse() const {
+        return m_heapBytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @returns The number of bytes of slabs reserved from the system.
+    */
+    size_t bytesReserved() const {
+        return m_slabs.bytesReserved();
+    }
+
+private:
+    /// Whether objects report the heap memory they hold, which must not change over their life.
+    static constexpr bool REPORTS_HEAP_BYTES = requires (const T& object) { object.heapBytes(); };
+
+    /// A slot either holds a live object or a link in the free list.
+    union Slot {
+        Slot* m_next;
+        alignas(T) std::byte m_storage[sizeof(T)];
+    };
+
+    void* allocateSlot() {
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        ++m_numLive;
+
+        if (m_freeList != nullptr) {
+            Slot* slot = m_freeList;
+            m_freeList = slot->m_next;
+            return slot;
+        }
+
+        if (m_bumpPtr == m_bumpEnd) {
+            // Current slab is exhausted, carve up a new one.
+            size_t slotsPerSlab = std::max<size_t>(1, m_slabs.slabBytes() / sizeof(Slot));
+
+            void* slab = m_slabs.allocateSlab(slotsPerSlab * sizeof(Slot));
+
+            m_bumpPtr = static_cast<Slot*>(slab);
+            m_bumpEnd = m_bumpPtr + slotsPerSlab;
+        }
+
+        return m_bumpPtr++;
+    }
+
+    void freeSlot(void* ptr) {
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        --m_numLive;
+
+        Slot* slot = static_cast<Slot*>(ptr);
+        slot->m_next = m_freeList;
+        m_freeList = slot;
+    }
+
+    SlabArena m_slabs;
+    SpinLock m_lock {};
+
+    Slot* m_freeList { nullptr };  // Singly-linked list of recycled slots.
+    Slot* m_bumpPtr { nullptr };   // Next never-used slot in the newest slab.
+    Slot* m_bumpEnd { nullptr };   // End of the newest slab.
+
+    std::atomic<size_t> m_numLive { 0 };  // Only written under the lock.
+    std::atomic<size_t> m_heapBytes { 0 };  // Heap memory reported by the live objects.
+};
+
+/**
+ * Pool of arrays of up to `MAX_COUNT` objects of type `T`, carved out of large slabs,
+ * for the variable-length arrays that nodes own (e.g. sparse edges).
+ *
+ * Keeps one free list per array length, so that allocation pops a free array of the
+ * exact length requested (or bumps a pointer into the newest slab), and destruction
+ * pushes the array back onto its list, both in O(1). As with `NodePool`, slabs are only
+ * returned to the system when the pool is destroyed, so all arrays must be destroyed first.
+ *
+ * Thread-safe, so that tree-parallel search can expand nodes concurrently.
+ *
+ * @tparam T The type of object held in the arrays.
+ * @tparam MAX_COUNT The longest array that may be allocated.
+*/
+template <typename T, int MAX_COUNT>
+class ArrayPool {
+public:
+    /**
+     * Constructs an empty pool. No memory is reserved until the first allocation.
+     *
+     * @param useHugePages Whether to back slabs with transparent huge pages where available.
+    */
+    explicit ArrayPool(bool useHugePages = false)
+        : m_slabs { useHugePages, alignof(Slot) } {
+    }
+
+    ~ArrayPool() {
+        assert(m_numLive == 0);
+    }
+
+    ArrayPool(const ArrayPool&) = delete;
+    ArrayPool& operator=(const ArrayPool&) = delete;
+
+    /**
+     * Value-initializes a new array of objects in the pool.
+     *
+     * @param count The length of the array, between 1 and `MAX_COUNT`.
+     *
+     * @returns A raw pointer to the first object, to be released with `destroy`.
+    */
+    T* create(int count) {
+        assert(count > 0 && count <= MAX_COUNT);
+
+        T* first = static_cast<T*>(allocateSlots(count));
+
+        try {
+            std::uninitialized_value_construct_n(first, count);
+            return first;
+
+        } catch (...) {
+            freeSlots(first, count);
+            throw;
+        }
+    }
+
+    /**
+     * Destroys an array created by this pool and recycles its slots.
+     *
+     * @param first The pointer returned by `create`.
+     * @param count The length it was created with.
+    */
+    void destroy(T* first, int count) {
+        std::destroy_n(first, count);
+        freeSlots(first, count);
+    }
+
+    /**
+     * @returns The number of bytes taken up by the arrays currently alive in the pool,
+     * not counting any heap memory that their objects own.
+     * May be read while other threads allocate.
+    */
+    size_t bytesInUse() const {
+        return m_numLive.load(std::memory_order_relaxed) * sizeof(Slot);
+    }
+
+    /**
+     * @returns The number of bytes of slabs reserved from the system.
+    */
+    size_t bytesReserved() const {
+        return m_slabs.bytesReserved();
+    }
+
+private:
+    /// A slot either holds a live object or, at the head of a free array, a link in its free list.
+    union Slot {
+        Slot* m_next;
+        alignas(T) std::byte m_storage[sizeof(T)];
+    };
+
+    // So that an array of slots lines up with an array of objects.
+    static_assert(sizeof(Slot) == sizeof(T));
+
+    void* allocateSlots(int count) {
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        if (m_freeLists[count] != nullptr) {
+            Slot* first = m_freeLists[count];
+            m_freeLists[count] = first->m_next;
+
+            m_numLive += count;
+            return first;
+        }
+
+        if (m_bumpEnd - m_bumpPtr < count) {
+            // Current slab is too short, carve up a new one.
+            size_t slotsPerSlab = std::max<size_t>(MAX_COUNT, m_slabs.slabBytes() / sizeof(Slot));
+
+            void* slab = m_slabs.allocateSlab(slotsPerSlab * sizeof(Slot));
+
+            // Keep what was left of the last slab as a shorter free array.
+            if (int numLeft = static_cast<int>(m_bumpEnd - m_bumpPtr); numLeft > 0) {
+                pushFree(m_bumpPtr, numLeft);
+            }
+
+            m_bumpPtr = static_cast<Slot*>(slab);
+            m_bumpEnd = m_bumpPtr + slotsPerSlab;
+        }
+
+        Slot* first = m_bumpPtr;
+        m_bumpPtr += count;
+
+        m_numLive += count;
+        return first;
+    }
+
+    void freeSlots(void* first, int count) {
+        std::lock_guard<SpinLock> guard { m_lock };
+
+        m_numLive -= count;
+        pushFree(static_cast<Slot*>(first), count);
+    }
+
+    void pushFree(Slot* first, int count) {
+        first->m_next = m_freeLists[count];
+        m_freeLists[count] = first;
+    }
+
+    SlabArena m_slabs;
+    SpinLock m_lock {};
+
+    std::array<Slot*, MAX_COUNT + 1> m_freeLists {};  // Singly-linked lists of recycled arrays, by length.
+    Slot* m_bumpPtr { nullptr };  // Next never-used slot in the newest slab.
+    Slot* m_bumpEnd { nullptr };  // End of the newest slab.
+
+    std::atomic<size_t> m_numLive { 0 };  // Number of live slots, only written under the lock.
+};
+
+/**
+ * Deleter for `std::unique_ptr` that returns objects to the pool they came from.
+ *
+ * Stateless, since `T` records its own pool through `getPool()`
+ * (`nullptr` for objects allocated on the heap).
+*/
+template <typename T>
+struct PoolDeleter {
+    void operator()(T* ptr) const {
+        NodePool<T>* pool = ptr->getPool();
+
+        if (pool != nullptr) {
+            pool->destroy(ptr);
+        } else {
+            delete ptr;
+        }
+    }
+};
+
+/// Owning pointer to an object that may live in a `NodePool`.
+template <typename T>
+using PoolPtr = std::unique_ptr<T, PoolDeleter<T>>;
+
+} // namespace SPRL
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SPRL_SPIN_LOCK_HPP
+#define SPRL_SPIN_LOCK_HPP
+
+/**
+ * @file SpinLock.hpp
+ * 
+ * A minimal test-and-test-and-set spin lock, for guarding very short
+ * critical sections (e.g. creating a single child node) where the
+ * footprint and syscall overhead of `std::mutex` is not worth it.
+*/
+
+#include <atomic>
+#include <thread>
+
+namespace SPRL {
+
+/**
+ * Spin lock satisfying the `Lockable` requirements,
+ * so it can be used with `std::lock_guard` and friends.
+*/
+class SpinLock {
+public:
+    /**
+     * Blocks until the lock is acquired.
+    */
+    void lock() {
+        while (m_locked.exchange(true, std::memory_order_acquire)) {
+            // Spin on a plain load to avoid bouncing the cache line.
+            while (m_locked.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * @returns Whether the lock was acquired, without blocking.
+    */
+    bool try_lock() {
+        return !m_locked.load(std::memory_order_relaxed)
+            && !m_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    /**
+     * Releases the lock.
+    */
+    void unlock() {
+        m_locked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> m_locked { false };
+};
+
+} // namespace SPRL
+
+#endif
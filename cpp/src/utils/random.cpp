@@ -23,11 +23,14 @@
 #include "constants.hpp"
 
 #include <atomic>
+#include <cmath>
 
 namespace SPRL {
 
 Random& GetRandom() {
-    static Random random(SEED, Random::kUniqueStream);
+    // One generator per thread, each on its own stream, so that
+    // search threads can draw random numbers without contention.
+    thread_local Random random(SEED, Random::kUniqueStream);
     return random;
 }
 
@@ -59,20 +62,34 @@ Random::Random(uint64_t seed, int stream)
     : seed_(ChooseSeed(seed)), impl_(seed_, ChooseStream(stream)) {}
 
 void Random::Dirichlet(float alpha, std::vector<float>& samples) {
+    Dirichlet(alpha, samples.data(), static_cast<int>(samples.size()));
+}
+
+void Random::Dirichlet(float alpha, float* samples, int numSamples) {
     std::gamma_distribution<float> distribution(alpha);
 
     float sum = 0;
-    for (float& sample : samples) {
-        sample = distribution(impl_);
-        sum += sample;
+    for (int i = 0; i < numSamples; ++i) {
+        samples[i] = distribution(impl_);
+        sum += samples[i];
     }
 
     float norm = 1 / sum;
-    for (float &sample : samples) {
-        sample *= norm;
+    for (int i = 0; i < numSamples; ++i) {
+        samples[i] *= norm;
     }
 }
 
+float Random::Gumbel() {
+    // Inverse transform sampling, again discarding any 0.0 draws.
+    float e;
+    do {
+        e = operator()();
+    } while (e == 0);
+
+    return -std::log(-std::log(e));
+}
+
 int Random::UniformInt(int a, int b) {
     std::uniform_int_distribution<int> distribution(a, b);
     return distribution(impl_);
@@ -84,6 +101,10 @@ uint64_t Random::UniformUint64(uint64_t a, uint64_t b) {
 }
 
 int Random::SampleCDF(const std::vector<float>& cdf) {
+    return SampleCDF(cdf.data(), static_cast<int>(cdf.size()));
+}
+
+int Random::SampleCDF(const float* cdf, int size) {
     // Take care to handle the case where the first elements in the CDF have zero
     // probability: discard any 0.0 values that the random number generator
     // produces. Admittedly, this isn't going to happen very often.
@@ -93,8 +114,8 @@ int Random::SampleCDF(const std::vector<float>& cdf) {
         e = operator()();
     } while (e == 0);
 
-    float x = cdf.back() * e;
-    return std::distance(cdf.begin(), std::lower_bound(cdf.begin(), cdf.end(), x));
+    float x = cdf[size - 1] * e;
+    return std::distance(cdf, std::lower_bound(cdf, cdf + size, x));
 }
 
 } // namespace SPRL
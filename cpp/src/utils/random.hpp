@@ -26,6 +26,7 @@
 
 #include <cstdint>
 #include <random>
+#include <vector>
 
 namespace SPRL {
 
@@ -50,6 +51,12 @@ public:
     /// Draw samples from a Dirichlet distribution.
     void Dirichlet(float alpha, std::vector<float>& samples);
 
+    /// Draw samples from a Dirichlet distribution into a caller-owned buffer, without allocating.
+    void Dirichlet(float alpha, float* samples, int numSamples);
+
+    /// Draw a sample from a standard Gumbel distribution.
+    float Gumbel();
+
     /// Draw a sample from a uniform distribution over integers in closed interval [a, b].
     int UniformInt(int a, int b);
 
@@ -60,6 +67,9 @@ public:
     /// Guarantees that elements with zero probability will not be sampled.
     int SampleCDF(const std::vector<float>& cdf);
 
+    /// Samples a CDF held in a caller-owned buffer, without copying it.
+    int SampleCDF(const float* cdf, int size);
+
     /// Returns a uniform random number in the half-open range [0, 1).
     float operator()() {
         return std::uniform_real_distribution<float>(0, 1)(impl_);
@@ -111,9 +121,9 @@ private:
 };
 
 /**
- * Singleton pattern for Random objects.
+ * Singleton pattern for Random objects, with one instance per thread.
  * 
- * @returns A reference to a static Random object.
+ * @returns A reference to a thread-local Random object.
 */
 Random& GetRandom();
 
@@ -0,0 +1,48 @@
+#ifndef SPRL_TESTS_UNIFORM_NETWORK_HPP
+#define SPRL_TESTS_UNIFORM_NETWORK_HPP
+
+#include "../src/networks/INetwork.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace SPRL::Testing {
+
+/**
+ * A network with a uniform policy over the legal actions and a neutral value,
+ * so that search is steered by nothing but its own statistics.
+ *
+ * @tparam State The state of the game.
+ * @tparam ACTION_SIZE The number of possible actions in the game.
+*/
+template <typename State, int ACTION_SIZE>
+class UniformNetwork : public INetwork<State, ACTION_SIZE> {
+public:
+    using ActionDist = GameActionDist<ACTION_SIZE>;
+
+    std::vector<std::pair<ActionDist, Value>> evaluate(
+        const std::vector<State>& states,
+        const std::vector<ActionDist>& masks) override {
+
+        std::vector<std::pair<ActionDist, Value>> outputs;
+        outputs.reserve(states.size());
+
+        for (const ActionDist& mask : masks) {
+            outputs.emplace_back(mask / mask.sum(), 0.0f);
+        }
+
+        m_numEvals += states.size();
+        return outputs;
+    }
+
+    int getNumEvals() override {
+        return m_numEvals;
+    }
+
+private:
+    int m_numEvals { 0 };
+};
+
+} // namespace SPRL::Testing
+
+#endif
@@ -0,0 +1,56 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/networks/InferenceService.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+
+} // namespace
+
+TEST_CASE( "Inference service coalesces concurrent requests into one batch" ) {
+    SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> network;
+
+    // Long enough that the batch only goes once full, short enough not to hang on a failure.
+    SPRL::InferenceService<State, SPRL::C4_ACTION_SIZE> service { &network, 8, std::chrono::seconds { 10 } };
+
+    SPRL::ConnectFourNode root;
+    std::vector<std::thread> threads;
+    std::vector<size_t> numOutputs(8);
+
+    // Assertions are only made on the main thread.
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&, i] {
+            numOutputs[i] = service.evaluate({ root.getGameState() }, { root.getActionMask() }).size();
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE( numOutputs == std::vector<size_t>(8, 1) );
+    REQUIRE( service.getNumEvals() == 8 );
+    REQUIRE( service.getNumBatches() == 1 );
+}
+
+TEST_CASE( "Inference service sends a lone request off after the maximum wait" ) {
+    SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> network;
+    SPRL::InferenceService<State, SPRL::C4_ACTION_SIZE> service { &network, 8, std::chrono::milliseconds { 50 } };
+
+    SPRL::ConnectFourNode root;
+
+    auto start = std::chrono::steady_clock::now();
+    auto outputs = service.evaluate({ root.getGameState() }, { root.getActionMask() });
+    auto waited = std::chrono::steady_clock::now() - start;
+
+    REQUIRE( outputs.size() == 1 );
+    REQUIRE( waited >= std::chrono::milliseconds { 50 } );
+    REQUIRE( service.getNumBatches() == 1 );
+}
@@ -0,0 +1,150 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/games/OthelloNode.hpp"
+#include "../src/symmetry/ConnectFourSymmetrizer.hpp"
+#include "../src/symmetry/D4GridSymmetrizer.hpp"
+#include "../src/uct/UCTTree.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts every heap allocation made while counting is switched on, by replacing the global allocator.
+// A thread can leave its own allocations uncounted for a while, without affecting the other threads.
+
+namespace {
+
+std::atomic<bool> g_countAllocations { false };
+std::atomic<long> g_numAllocations { 0 };
+thread_local bool t_uncounted { false };
+
+void* countedAlloc(std::size_t size, std::size_t alignment) {
+    if (g_countAllocations.load(std::memory_order_relaxed) && !t_uncounted) {
+        g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size = (size == 0) ? 1 : size;
+    void* ptr = (alignment <= alignof(std::max_align_t))
+        ? std::malloc(size)
+        : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+
+    if (ptr == nullptr) {
+        throw std::bad_alloc {};
+    }
+
+    return ptr;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size, 0); }
+void* operator new[](std::size_t size) { return countedAlloc(size, 0); }
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlloc(size, static_cast<std::size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlloc(size, static_cast<std::size_t>(align)); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+
+/**
+ * A uniform network that leaves its own allocations, i.e. returning the outputs, uncounted,
+ * since they belong to the network interface rather than to the search.
+*/
+template <typename State, int ACTION_SIZE>
+class UncountedNetwork : public SPRL::Testing::UniformNetwork<State, ACTION_SIZE> {
+public:
+    using ActionDist = SPRL::GameActionDist<ACTION_SIZE>;
+
+    std::vector<std::pair<ActionDist, SPRL::Value>> evaluate(
+        const std::vector<State>& states,
+        const std::vector<ActionDist>& masks) override {
+
+        t_uncounted = true;
+        auto outputs = SPRL::Testing::UniformNetwork<State, ACTION_SIZE>::evaluate(states, masks);
+
+        t_uncounted = false;
+        return outputs;
+    }
+};
+
+/**
+ * Warms a tree up with a search and a reroot, then counts the allocations of a further search.
+ *
+ * @returns The number of heap allocations made by the search after warming up.
+*/
+template <typename ImplNode, typename State, int ACTION_SIZE>
+long countSteadyStateAllocations(SPRL::UCTTree<ImplNode, State, ACTION_SIZE>& tree, bool pipelined) {
+    UncountedNetwork<State, ACTION_SIZE> network;
+
+    // Grow the batch buffers and pools, then reroot so that the pruned siblings leave
+    // plenty of recycled slots for the nodes and edges of the next search.
+    tree.search(4096, 8, 4, &network, 1.0f, 1, pipelined);
+
+    auto visits = tree.getDecisionNode()->getEdgeStatistics().m_numVisits;
+    tree.advanceDecision(std::distance(visits.begin(), std::max_element(visits.begin(), visits.end())));
+
+    g_numAllocations.store(0);
+    g_countAllocations.store(true);
+
+    int traversals = tree.search(512, 8, 4, &network, 1.0f, 1, pipelined);
+
+    g_countAllocations.store(false);
+
+    REQUIRE( traversals >= 512 );
+    return g_numAllocations.load();
+}
+
+} // namespace
+
+TEST_CASE( "Search does not allocate per traversal in steady state" ) {
+    SPRL::ConnectFourSymmetrizer symmetrizer;
+
+    SPRL::UCTTree<SPRL::ConnectFourNode, SPRL::ConnectFourNode::State, SPRL::C4_ACTION_SIZE> tree {
+        std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, &symmetrizer, true
+    };
+
+    bool pipelined = false;
+
+    SECTION( "Batches of selected leaves only" ) {}
+
+    SECTION( "Batches topped up with speculative leaves" ) {
+        tree.setSpeculativeFill(true);
+    }
+
+    SECTION( "Batches evaluated while the next is selected" ) {
+        pipelined = true;
+    }
+
+    REQUIRE( countSteadyStateAllocations(tree, pipelined) == 0 );
+}
+
+TEST_CASE( "Search does not allocate per traversal in steady state under the sparse edge layout" ) {
+    SPRL::D4GridSymmetrizer<SPRL::OTH_BOARD_WIDTH, SPRL::OTH_HISTORY_SIZE> symmetrizer;
+
+    SPRL::UCTTree<SPRL::OthelloNode, SPRL::OthelloNode::State, SPRL::OTH_ACTION_SIZE> tree {
+        std::make_unique<SPRL::OthelloNode>(), 0.25f, 0.5f, &symmetrizer, true
+    };
+
+    bool pipelined = false;
+
+    SECTION( "Batches of selected leaves only" ) {}
+
+    SECTION( "Batches topped up with speculative leaves" ) {
+        tree.setSpeculativeFill(true);
+    }
+
+    SECTION( "Batches evaluated while the next is selected" ) {
+        pipelined = true;
+    }
+
+    REQUIRE( countSteadyStateAllocations(tree, pipelined) == 0 );
+}
@@ -0,0 +1,101 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/networks/INetwork.hpp"
+#include "../src/uct/UCTTree.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+using ActionDist = SPRL::GameActionDist<SPRL::C4_ACTION_SIZE>;
+using Tree = SPRL::UCTTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+
+/**
+ * A network whose outputs only depend on the order of the states it is asked about, so that
+ * two trees searched alike get the same outputs. No two priors are in a rational ratio, so that
+ * selection does not meet ties, which are broken at random. Values are multiples of 1/8, whose
+ * sums are exact in any order.
+*/
+class ScriptedNetwork : public SPRL::INetwork<State, SPRL::C4_ACTION_SIZE> {
+public:
+    std::vector<std::pair<ActionDist, SPRL::Value>> evaluate(
+        const std::vector<State>& states,
+        const std::vector<ActionDist>& masks) override {
+
+        // Square roots of distinct primes, none a rational multiple of another.
+        constexpr float PRIMES[SPRL::C4_ACTION_SIZE] = { 2.0f, 3.0f, 5.0f, 7.0f, 11.0f, 13.0f, 17.0f };
+
+        std::vector<std::pair<ActionDist, SPRL::Value>> outputs;
+        outputs.reserve(states.size());
+
+        for (const ActionDist& mask : masks) {
+            ActionDist policy {};
+            for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+                policy[action] = mask[action] * std::sqrt(PRIMES[action]);
+            }
+
+            outputs.emplace_back(policy / policy.sum(), static_cast<float>(m_numEvals++ * 5 % 9 - 4) / 8.0f);
+        }
+
+        return outputs;
+    }
+
+    int getNumEvals() override {
+        return m_numEvals;
+    }
+
+private:
+    int m_numEvals { 0 };
+};
+
+/**
+ * Checks that two subtrees hold the same edge statistics throughout.
+*/
+void checkSame(const Tree::UNode* expected, const Tree::UNode* actual) {
+    REQUIRE( (actual != nullptr) == (expected != nullptr) );
+    if (expected == nullptr || expected->isTerminal()) {
+        return;
+    }
+
+    auto expectedStats = expected->getEdgeStatistics();
+    auto actualStats = actual->getEdgeStatistics();
+
+    for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+        REQUIRE( actualStats.m_numVisits[action] == expectedStats.m_numVisits[action] );
+        REQUIRE( actualStats.m_totalValues[action] == expectedStats.m_totalValues[action] );
+
+        checkSame(expected->getChild(action), actual->getChild(action));
+    }
+}
+
+} // namespace
+
+TEST_CASE( "Batched backup matches backing up every leaf on its own" ) {
+    ScriptedNetwork batchedNetwork;
+    ScriptedNetwork singleNetwork;
+
+    Tree batched { std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr, false };
+    Tree single { std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr, false };
+
+    // Batches with repeated leaves and shared path prefixes, backed up together by `search`.
+    int traversals = batched.search(1024, 16, 8, &batchedNetwork);
+
+    // The same batches, each leaf backed up on its own along the parent pointers.
+    int singleTraversals = 0;
+    while (singleTraversals < 1024) {
+        auto [leaves, numSelected] = single.searchAndGetLeaves(16, 8, &singleNetwork);
+        if (!leaves.empty()) {
+            single.evaluateAndBackpropLeaves(leaves, &singleNetwork);
+        }
+
+        singleTraversals += numSelected;
+    }
+
+    REQUIRE( singleTraversals == traversals );
+    REQUIRE( single.getDecisionNode()->N() == batched.getDecisionNode()->N() );
+    REQUIRE( singleNetwork.getNumEvals() == batchedNetwork.getNumEvals() );
+
+    checkSame(single.getDecisionNode(), batched.getDecisionNode());
+}
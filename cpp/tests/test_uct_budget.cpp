@@ -0,0 +1,182 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/games/GoNode.hpp"
+#include "../src/games/OthelloNode.hpp"
+#include "../src/uct/UCTTree.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <numeric>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+using Tree = SPRL::UCTTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+using ActionDist = SPRL::GameActionDist<SPRL::C4_ACTION_SIZE>;
+
+/**
+ * A network whose policy puts nearly all its weight on the middle column, when legal,
+ * so that PUCT keeps coming back to one edge at every node.
+*/
+class PeakedNetwork : public SPRL::INetwork<State, SPRL::C4_ACTION_SIZE> {
+public:
+    std::vector<std::pair<ActionDist, SPRL::Value>> evaluate(
+        const std::vector<State>& states,
+        const std::vector<ActionDist>& masks) override {
+
+        constexpr SPRL::ActionIdx PEAK = SPRL::C4_ACTION_SIZE / 2;
+
+        std::vector<std::pair<ActionDist, SPRL::Value>> outputs;
+        outputs.reserve(states.size());
+
+        for (const ActionDist& mask : masks) {
+            ActionDist policy = mask * 0.01f;
+            if (mask[PEAK] != 0.0f) {
+                policy[PEAK] = 1.0f;
+            }
+
+            outputs.emplace_back(policy / policy.sum(), 0.0f);
+        }
+
+        m_numEvals += states.size();
+        return outputs;
+    }
+
+    int getNumEvals() override {
+        return m_numEvals;
+    }
+
+private:
+    int m_numEvals { 0 };
+};
+
+float sumVisits(const Tree::UNode* node) {
+    auto visits = node->getEdgeStatistics().m_numVisits;
+    return std::accumulate(visits.begin(), visits.end(), 0.0f);
+}
+
+/**
+ * Checks that every node with children passed its visits on to them, but for its own
+ * evaluation and the traversals of a batch that collided on it while it was in flight,
+ * rather than evaluating itself over and over.
+ *
+ * @returns The number of nodes checked.
+*/
+int checkVisitsReachChildren(const Tree::UNode* node, float slack) {
+    if (node->isTerminal()) {
+        return 0;
+    }
+
+    int numChecked = 0;
+    bool anyChild = false;
+
+    for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+        if (const Tree::UNode* child = node->getChild(action); child != nullptr) {
+            anyChild = true;
+            numChecked += checkVisitsReachChildren(child, slack);
+        }
+    }
+
+    if (anyChild) {
+        REQUIRE( node->N() - sumVisits(node) <= slack );
+        ++numChecked;
+    }
+
+    return numChecked;
+}
+
+/**
+ * @returns The number of UCT nodes in a subtree, and the bytes they and their edges take up.
+*/
+template <typename Node, int ACTION_SIZE>
+std::pair<size_t, size_t> walkMemoryUsage(const Node* node) {
+    std::pair<size_t, size_t> total { 1, node->memoryUsage() };
+
+    if (node->isTerminal()) {
+        return total;
+    }
+
+    for (SPRL::ActionIdx action = 0; action < ACTION_SIZE; ++action) {
+        if (const Node* child = node->getChild(action); child != nullptr) {
+            auto [numNodes, bytes] = walkMemoryUsage<Node, ACTION_SIZE>(child);
+            total.first += numNodes;
+            total.second += bytes;
+        }
+    }
+
+    return total;
+}
+
+} // namespace
+
+TEST_CASE( "A full node budget still spreads traversals over the existing children" ) {
+    constexpr size_t MAX_NODES = 60;
+    constexpr int NUM_TRAVERSALS = 20000;
+    constexpr int MAX_BATCH_SIZE = 8;
+
+    PeakedNetwork network;
+
+    Tree tree {
+        std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr, false,
+        false, SPRL::Transpositions::NONE, MAX_NODES
+    };
+
+    for (int move = 0; move < 3; ++move) {
+        float rootVisits = sumVisits(tree.getDecisionNode());
+        int traversals = tree.search(NUM_TRAVERSALS, MAX_BATCH_SIZE, MAX_BATCH_SIZE, &network, 1.0f);
+        REQUIRE( traversals >= NUM_TRAVERSALS );
+
+        // Never cut off at the decision node, but for the first batch, which evaluates it.
+        REQUIRE( sumVisits(tree.getDecisionNode()) - rootVisits >= traversals - MAX_BATCH_SIZE );
+
+        // The budget holds, give or take the children of the decision node, which are always allowed.
+        REQUIRE( tree.getNumNodes() <= MAX_NODES + SPRL::C4_ACTION_SIZE );
+
+        // The decision node keeps the visits it got as a child of the last one, so start below it.
+        int numChecked = 0;
+        for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+            if (const Tree::UNode* child = tree.getDecisionNode()->getChild(action); child != nullptr) {
+                numChecked += checkVisitsReachChildren(child, 1.0f + MAX_BATCH_SIZE);
+            }
+        }
+
+        REQUIRE( numChecked > 0 );
+
+        tree.advanceDecision(SPRL::C4_ACTION_SIZE / 2);
+    }
+}
+
+TEST_CASE( "Memory usage counts what the nodes hold on the heap" ) {
+    SECTION( "Sparse edges, from the edge pool" ) {
+        using OthelloState = SPRL::OthelloNode::State;
+        using OthelloTree = SPRL::UCTTree<SPRL::OthelloNode, OthelloState, SPRL::OTH_ACTION_SIZE>;
+
+        SPRL::Testing::UniformNetwork<OthelloState, SPRL::OTH_ACTION_SIZE> network;
+        OthelloTree tree { std::make_unique<SPRL::OthelloNode>(), 0.25f, 0.5f, nullptr, false };
+
+        tree.search(1024, 8, 8, &network, 1.0f);
+
+        auto [numNodes, bytes] = walkMemoryUsage<OthelloTree::UNode, SPRL::OTH_ACTION_SIZE>(tree.getDecisionNode());
+        REQUIRE( numNodes == tree.getNumNodes() );
+
+        // Othello nodes hold nothing on the heap, so the tree is exactly its nodes and their edges.
+        REQUIRE( tree.getMemoryUsage() == bytes + numNodes * sizeof(SPRL::OthelloNode) );
+    }
+
+    SECTION( "Sparse edges and the position history of Go" ) {
+        using GoState = SPRL::GoNode::State;
+        using GoTree = SPRL::UCTTree<SPRL::GoNode, GoState, SPRL::GO_ACTION_SIZE>;
+
+        SPRL::Testing::UniformNetwork<GoState, SPRL::GO_ACTION_SIZE> network;
+        GoTree tree { std::make_unique<SPRL::GoNode>(), 0.25f, 0.5f, nullptr, false };
+
+        tree.search(1024, 8, 8, &network, 1.0f);
+
+        auto [numNodes, bytes] = walkMemoryUsage<GoTree::UNode, SPRL::GO_ACTION_SIZE>(tree.getDecisionNode());
+        REQUIRE( numNodes == tree.getNumNodes() );
+
+        // Every Go node remembers at least its own position.
+        size_t minHistoryBytes = numNodes * (sizeof(void*) + sizeof(SPRL::ZobristHash));
+        REQUIRE( tree.getMemoryUsage() >= bytes + numNodes * sizeof(SPRL::GoNode) + minHistoryBytes );
+    }
+}
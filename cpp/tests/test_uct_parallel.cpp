@@ -0,0 +1,84 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/uct/UCTTree.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <mutex>
+#include <numeric>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+using Tree = SPRL::UCTTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+
+/**
+ * The uniform network, made safe to call from several threads at once.
+*/
+class ThreadSafeNetwork : public SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> {
+public:
+    std::vector<std::pair<ActionDist, SPRL::Value>> evaluate(
+        const std::vector<State>& states,
+        const std::vector<ActionDist>& masks) override {
+
+        std::lock_guard<std::mutex> guard { m_mutex };
+        return UniformNetwork::evaluate(states, masks);
+    }
+
+    bool isThreadSafe() const override {
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+};
+
+/**
+ * Checks that no virtual loss is left behind in the tree: every node has been visited
+ * at least as often as all its children together.
+*/
+void checkVisits(const Tree::UNode* node) {
+    if (node->isTerminal()) {
+        return;
+    }
+
+    auto visits = node->getEdgeStatistics().m_numVisits;
+    REQUIRE( std::accumulate(visits.begin(), visits.end(), 0.0f) <= node->N() );
+
+    for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+        if (const Tree::UNode* child = node->getChild(action); child != nullptr) {
+            checkVisits(child);
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE( "Tree-parallel search counts every traversal once" ) {
+    ThreadSafeNetwork network;
+
+    Tree tree {
+        std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr, false
+    };
+
+    bool pipelined = false;
+
+    SECTION( "Threads evaluating their own batches" ) {}
+
+    SECTION( "Threads evaluating their batches while selecting the next" ) {
+        pipelined = true;
+    }
+
+    for (int move = 0; move < 3; ++move) {
+        // The decision node keeps the visits it got as a child of the last one.
+        float numVisits = tree.getDecisionNode()->N();
+        int traversals = tree.search(2048, 8, 4, &network, 1.0f, 4, pipelined);
+
+        REQUIRE( traversals >= 2048 );
+        REQUIRE( tree.getDecisionNode()->N() == numVisits + traversals );
+
+        checkVisits(tree.getDecisionNode());
+
+        tree.advanceDecision(3);
+    }
+}
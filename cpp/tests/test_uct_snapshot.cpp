@@ -0,0 +1,129 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/games/OthelloNode.hpp"
+#include "../src/uct/UCTTree.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+using Tree = SPRL::UCTTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+
+std::unique_ptr<Tree> makeTree() {
+    return std::make_unique<Tree>(std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr, false);
+}
+
+} // namespace
+
+TEST_CASE( "Snapshot restores the search below the decision node" ) {
+    SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> network;
+    std::string path = (std::filesystem::temp_directory_path() / "test_uct_snapshot.bin").string();
+
+    std::unique_ptr<Tree> source = makeTree();
+    source->advanceDecision(3);
+    source->search(2048, 8, 4, &network);
+
+    REQUIRE( source->saveSnapshot(path) );
+
+    // Loading into a fresh tree replays the path to the saved node.
+    std::unique_ptr<Tree> restored = makeTree();
+    REQUIRE( restored->loadSnapshot(path) );
+
+    auto expected = source->getDecisionNode()->getEdgeStatistics();
+    auto actual = restored->getDecisionNode()->getEdgeStatistics();
+
+    for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+        REQUIRE( actual.m_numVisits[action] == expected.m_numVisits[action] );
+        REQUIRE( actual.m_totalValues[action] == expected.m_totalValues[action] );
+        REQUIRE( actual.m_childPriors[action] == expected.m_childPriors[action] );
+    }
+
+    REQUIRE( restored->getDecisionNode()->N() == source->getDecisionNode()->N() );
+
+    // Search carries on from the restored statistics, restoring only the nodes it reaches.
+    restored->search(64, 8, 4, &network);
+
+    REQUIRE( restored->getDecisionNode()->N() >= source->getDecisionNode()->N() + 64 );
+    REQUIRE( restored->getNumNodes() < source->getNumNodes() );
+
+    SECTION( "Snapshot only loads into an unsearched node on its path" ) {
+        REQUIRE_FALSE( restored->loadSnapshot(path) );
+
+        std::unique_ptr<Tree> elsewhere = makeTree();
+        elsewhere->advanceDecision(2);
+        REQUIRE_FALSE( elsewhere->loadSnapshot(path) );
+        REQUIRE_FALSE( makeTree()->loadSnapshot(path + ".missing") );
+    }
+
+    SECTION( "Damaged records are ignored rather than read out of bounds" ) {
+        std::unique_ptr<SPRL::TreeSnapshot> snapshot = SPRL::TreeSnapshot::open(path, SPRL::C4_ACTION_SIZE, false);
+        REQUIRE( snapshot != nullptr );
+
+        SPRL::SnapshotHeader header = snapshot->header();
+        snapshot.reset();
+
+        // Point every edge of the saved node past the node records, then cut off the edge records.
+        std::fstream file { path, std::ios::binary | std::ios::in | std::ios::out };
+        for (int edgeIdx = 0; edgeIdx < SPRL::C4_ACTION_SIZE; ++edgeIdx) {
+            int32_t child = header.m_numNodes + edgeIdx;
+            file.seekp(header.m_edgesOffset + edgeIdx * sizeof(SPRL::SnapshotEdge));
+            file.write(reinterpret_cast<const char*>(&child), sizeof(child));
+        }
+        file.close();
+
+        std::unique_ptr<Tree> damaged = makeTree();
+        REQUIRE( damaged->loadSnapshot(path) );
+        damaged->search(256, 8, 4, &network);
+        REQUIRE( damaged->getDecisionNode()->N() >= source->getDecisionNode()->N() + 256 );
+
+        std::filesystem::resize_file(path, header.m_edgesOffset);
+        REQUIRE_FALSE( makeTree()->loadSnapshot(path) );
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Snapshot keeps the network policy clean of noise under the sparse layout" ) {
+    using OthelloState = SPRL::OthelloNode::State;
+    using OthelloTree = SPRL::UCTTree<SPRL::OthelloNode, OthelloState, SPRL::OTH_ACTION_SIZE>;
+
+    SPRL::Testing::UniformNetwork<OthelloState, SPRL::OTH_ACTION_SIZE> network;
+    std::string path = (std::filesystem::temp_directory_path() / "test_uct_snapshot_sparse.bin").string();
+
+    auto checkPolicy = [&path]() {
+        std::unique_ptr<SPRL::TreeSnapshot> snapshot = SPRL::TreeSnapshot::open(path, SPRL::OTH_ACTION_SIZE, true);
+        REQUIRE( snapshot != nullptr );
+
+        int numEdges = snapshot->node(0).m_numEdges;
+        bool anyNoise = false;
+
+        for (int edgeIdx = 0; edgeIdx < numEdges; ++edgeIdx) {
+            const SPRL::SnapshotEdge& edge = snapshot->edge(0, edgeIdx);
+
+            REQUIRE( edge.m_policy == 1.0f / numEdges );
+            anyNoise |= std::abs(edge.m_prior - edge.m_policy) > 1e-6f;
+        }
+
+        REQUIRE( anyNoise );
+    };
+
+    OthelloTree source { std::make_unique<SPRL::OthelloNode>(), 0.25f, 0.5f, nullptr, true };
+    source.search(256, 8, 4, &network);
+
+    REQUIRE( source.saveSnapshot(path) );
+    checkPolicy();
+
+    // A tree restored from the snapshot saves the clean policy again.
+    OthelloTree restored { std::make_unique<SPRL::OthelloNode>(), 0.25f, 0.5f, nullptr, true };
+    REQUIRE( restored.loadSnapshot(path) );
+    REQUIRE( restored.saveSnapshot(path) );
+    checkPolicy();
+
+    std::filesystem::remove(path);
+}
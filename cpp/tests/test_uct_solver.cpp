@@ -0,0 +1,105 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/uct/RootParallelTree.hpp"
+#include "../src/uct/UCTTree.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+using Tree = SPRL::UCTTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+using ParallelTree = SPRL::RootParallelTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+
+SPRL::ActionIdx mostVisited(Tree& tree) {
+    auto visits = tree.getDecisionNode()->getEdgeStatistics().m_numVisits;
+    return std::distance(visits.begin(), std::max_element(visits.begin(), visits.end()));
+}
+
+ParallelTree makeParallelTree(int numTrees) {
+    std::vector<std::unique_ptr<SPRL::GameNode<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>>> gameRoots;
+    for (int k = 0; k < numTrees; ++k) {
+        gameRoots.push_back(std::make_unique<SPRL::ConnectFourNode>());
+    }
+
+    return ParallelTree {
+        std::move(gameRoots), 0.25f, 0.5f, nullptr, false, SPRL::Transpositions::NONE, 0, true
+    };
+}
+
+} // namespace
+
+TEST_CASE( "Solver proves and plays out a forced win" ) {
+    SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> network;
+
+    Tree tree {
+        std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr,
+        false, false, SPRL::Transpositions::NONE, 0, true
+    };
+
+    // The first player has two in a row along the bottom, open at both ends:
+    // extending it to three leaves two threats the opponent cannot both block.
+    for (SPRL::ActionIdx action : { 2, 2, 3, 3 }) {
+        tree.advanceDecision(action);
+    }
+
+    tree.search(4096, 8, 4, &network);
+
+    REQUIRE( tree.getDecisionNode()->getProof() == SPRL::Proof::WIN );
+
+    SPRL::ActionIdx action = mostVisited(tree);
+    REQUIRE( (action == 1 || action == 4) );
+
+    // Whatever the opponent replies, they are lost, and the win follows in two moves.
+    tree.advanceDecision(action);
+    tree.search(1024, 8, 4, &network);
+
+    REQUIRE( tree.getDecisionNode()->getProof() == SPRL::Proof::LOSS );
+
+    tree.advanceDecision(mostVisited(tree));
+    tree.search(1024, 8, 4, &network);
+    tree.advanceDecision(mostVisited(tree));
+
+    REQUIRE( tree.getDecisionNode()->isTerminal() );
+    REQUIRE( tree.getDecisionNode()->getProof() == SPRL::Proof::LOSS );
+}
+
+TEST_CASE( "Root visits play by the proofs" ) {
+    SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> network;
+    ParallelTree tree = makeParallelTree(2);
+
+    // The first player has three in a row along the bottom, open only to the right.
+    for (SPRL::ActionIdx action : { 0, 6, 1, 6, 2 }) {
+        tree.advanceDecision(action);
+    }
+
+    SECTION( "Moves proven lost keep no visits" ) {
+        tree.search(4096, 8, 4, &network);
+
+        // Every move but the block loses at once, yet was visited before it was proven lost.
+        SPRL::GameActionDist<SPRL::C4_ACTION_SIZE> visits = tree.getRootVisits();
+        REQUIRE( visits[3] > 0.0f );
+
+        for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+            if (action != 3) {
+                REQUIRE( visits[action] == 0.0f );
+            }
+        }
+    }
+
+    SECTION( "Only proven wins keep visits" ) {
+        tree.advanceDecision(5);
+        tree.search(4096, 8, 4, &network);
+
+        SPRL::GameActionDist<SPRL::C4_ACTION_SIZE> visits = tree.getRootVisits();
+        REQUIRE( visits[3] > 0.0f );
+
+        for (SPRL::ActionIdx action = 0; action < SPRL::C4_ACTION_SIZE; ++action) {
+            if (action != 3) {
+                REQUIRE( visits[action] == 0.0f );
+            }
+        }
+    }
+}
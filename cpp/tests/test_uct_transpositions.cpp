@@ -0,0 +1,72 @@
+#include "../src/games/ConnectFourNode.hpp"
+#include "../src/uct/UCTTree.hpp"
+#include "UniformNetwork.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <initializer_list>
+#include <numeric>
+
+namespace {
+
+using State = SPRL::ConnectFourNode::State;
+using Tree = SPRL::UCTTree<SPRL::ConnectFourNode, State, SPRL::C4_ACTION_SIZE>;
+using Node = Tree::UNode;
+
+/**
+ * @returns The node reached from the decision node by the given actions, or nullptr if it was never created.
+*/
+const Node* follow(Tree& tree, std::initializer_list<SPRL::ActionIdx> actions) {
+    const Node* node = tree.getDecisionNode();
+    for (SPRL::ActionIdx action : actions) {
+        node = (node != nullptr) ? node->getChild(action) : nullptr;
+    }
+
+    return node;
+}
+
+/**
+ * @returns The visits to the children of a node, i.e. the traversals that went on below it.
+*/
+float visitsBelow(const Node* node) {
+    auto visits = node->getEdgeStatistics().m_numVisits;
+    return std::accumulate(visits.begin(), visits.end(), 0.0f);
+}
+
+} // namespace
+
+TEST_CASE( "Search keeps growing every copy of a transposed position" ) {
+    SPRL::Testing::UniformNetwork<State, SPRL::C4_ACTION_SIZE> network;
+
+    Tree tree {
+        std::make_unique<SPRL::ConnectFourNode>(), 0.25f, 0.5f, nullptr,
+        false, false, SPRL::Transpositions::STATISTICS
+    };
+
+    tree.advanceDecision(3);
+
+    // Two move orders that reach the same position.
+    std::initializer_list<SPRL::ActionIdx> first = { 0, 1, 2 };
+    std::initializer_list<SPRL::ActionIdx> second = { 2, 1, 0 };
+
+    tree.search(8192, 8, 4, &network);
+
+    const Node* firstCopy = follow(tree, first);
+    const Node* secondCopy = follow(tree, second);
+
+    REQUIRE( firstCopy != nullptr );
+    REQUIRE( secondCopy != nullptr );
+    REQUIRE( firstCopy->getHash() == secondCopy->getHash() );
+
+    float firstBelow = visitsBelow(firstCopy);
+    float secondBelow = visitsBelow(secondCopy);
+
+    REQUIRE( firstBelow > 0.0f );
+    REQUIRE( secondBelow > 0.0f );
+
+    // Neither copy is cut off for good once the other has been visited.
+    tree.search(8192, 8, 4, &network);
+
+    REQUIRE( visitsBelow(firstCopy) > firstBelow );
+    REQUIRE( visitsBelow(secondCopy) > secondBelow );
+}